@@ -35,12 +35,15 @@
 #include "parseutil.hpp"  // fileMatches
 #include "directory.hpp"
 #include "hasher.hpp"
+#include "reporter.hpp"
+#include "filetable.hpp"
+#include "groupsort.hpp"
 
 #include <assert.h>
 #include <fstream>
 #include <iostream>
 #include <iomanip>
-#include <map>
+#include <algorithm>
 #include <vector>
 
 
@@ -227,25 +230,26 @@ bool RunCommand(const char* command, DWORD* pExitCode, int waitMsec) {
 
 
 // ---------------------------------------------------------------------------
-static struct stat  print(const lstring& path, struct stat* pInfo) {
-    struct stat info;
+// Print file details, stat path only if metadata not captured during scan.
+static void print(const lstring& path, const FileInfo* pInfo) {
+    FileInfo info;
     int result = 0;
 
-    if (pInfo == NULL) {
+    if (pInfo == NULL || !pInfo->has(INFO_ALL)) {
         pInfo = &info;
-        result = stat(path, pInfo);
+        result = DirUtil::getInfo(info, path) ? 0 : -1;
     }
 
     char timeBuf[128];
     errno_t err = 0;
 
     if (result == 0) {
-        // err = ctime_s(timeBuf, sizeof(timeBuf), &pInfo->st_mtime);
+        // err = ctime_s(timeBuf, sizeof(timeBuf), &pInfo->mtime);
         struct tm TM;
 #ifdef HAVE_WIN
-        err = localtime_s(&TM, &pInfo->st_mtime);
+        err = localtime_s(&TM, &pInfo->mtime);
 #else
-        TM = *localtime(&pInfo->st_mtime);
+        TM = *localtime(&pInfo->mtime);
 #endif
         strftime(timeBuf, sizeof(timeBuf), "%a %d-%b-%Y %h:%M %p", &TM);
         if (err) {
@@ -255,18 +259,17 @@ static struct stat  print(const lstring& path, struct stat* pInfo) {
 #ifdef HAVE_WIN
             bool isSymLink = false;
 #else
-            bool isSymLink = S_ISLNK(pInfo->st_flags);
+            bool isSymLink = S_ISLNK(pInfo->mode);
 #endif
-            std::cout << std::setw(8) << pInfo->st_size
+            std::cout << std::setw(8) << pInfo->size
                 << " " << timeBuf << " "
-                << std::setw(10) << pInfo->st_ino
+                << std::setw(10) << pInfo->ino
                 << (isSymLink ? " S" : " ")
-                << "Links " << pInfo->st_nlink
+                << "Links " << pInfo->nlink
                 << " " << path
                 << std::endl;
         }
     }
-    return *pInfo;
 }
 
 
@@ -308,6 +311,42 @@ bool Command::validFile(const lstring& name, const lstring& fullname) {
     return isValid;
 }
 
+// ---------------------------------------------------------------------------
+// Directory filter applied before descending, only exclude patterns prune.
+// Path patterns see the directory with a trailing slash, so -Exc=*/build/* prunes build.
+bool Command::validDir(const lstring& name, const lstring& fullname) {
+    if (excludeFilePatList.empty() && excludePathPatList.empty())
+        return true;
+
+    lstring dirPath(fullname);
+    if (!dirPath.empty() && dirPath.back() != Directory_files::SLASH_CHAR)
+        dirPath += Directory_files::SLASH_CHAR;
+    bool isValid =
+        !ParseUtil::FileMatches(name, excludeFilePatList, false) &&
+        !ParseUtil::FileMatches(dirPath, excludePathPatList, false);
+
+    if (! isValid) {
+        pruneCnt++;
+        if (verbose)
+            Colors::showError("Pruned:", fullname.c_str());
+    }
+    return isValid;
+}
+
+// ---------------------------------------------------------------------------
+// Size and time predicates, fields not captured do not reject the file.
+bool Command::validInfo(const FileInfo& info) const {
+    if (info.has(INFO_SIZE)) {
+        if (info.size < minSize || (maxSize != 0 && info.size > maxSize))
+            return false;
+    }
+    if (info.has(INFO_TIME)) {
+        if ((newerTime != 0 && info.mtime < newerTime) || (olderTime != 0 && info.mtime > olderTime))
+            return false;
+    }
+    return true;
+}
+
 // ---------------------------------------------------------------------------
 const char*  Command::absOrRel(const char* fullPath) const {
     if (!showAbsPath && strncmp(fullPath, CWD_BUF, CWD_LEN) == 0)  
@@ -321,76 +360,114 @@ const char*  Command::absOrRel(const string& fullPath) const {
     else
         return fullPath.c_str();
 }
+std::string_view Command::absOrRel(std::string_view fullPath) const {
+    if (!showAbsPath && fullPath.compare(0, CWD_LEN, CWD_BUF, CWD_LEN) == 0 && fullPath.length() > CWD_LEN)
+        return fullPath.substr(CWD_LEN + 1);
+    else
+        return fullPath;
+}
 
 
 // ---------------------------------------------------------------------------
 // ---------------------------------------------------------------------------
-map<std::string, IntList> fileList;
-std::vector<std::string> pathList;
-std::string lastPath;
-unsigned lastPathIdx = 0;
+FileTable fileTable;
 
 // ---------------------------------------------------------------------------
 bool DupFiles::begin(StringList& fileDirList) {
-    fileList.clear();
-    pathList.clear();
-    lastPathIdx = 0;
+    if (maxMem != 0 && (justName || sameName)) {
+        Colors::showError("-maxMem only applies to -all, ignored");
+        maxMem = 0;
+    } else if (maxMem != 0 && maxMem < MIN_MAX_MEM) {
+        Colors::showError("-maxMem below 1m, using 1m");
+        maxMem = MIN_MAX_MEM;
+    }
+    fileTable.clear(infoNeed() == INFO_ALL, poolBlockSize());
+    sizeRuns.clear();
     return true;
 }
 
 // ---------------------------------------------------------------------------
 // Locate matching files which are not in exclude list.
 // Locate duplicate files.
-size_t DupFiles::add(const lstring& fullname) {
-    size_t fileCount = 0;
+size_t DupFiles::add(const lstring& fullname, const FileInfo& info) {
     lstring name;
     DirUtil::getName(name, fullname);
 
-    if (validFile(name, fullname)) {
-        std::string path = fullname.substr(0, fullname.length() - name.length());
-        if (lastPath != path) {
-            if (lastPath.rfind(path, 0) == 0) {
-                for (lastPathIdx--; lastPathIdx < pathList.size(); lastPathIdx--) {
-                    lastPath = pathList[lastPathIdx];
-                    if (lastPath == path) {
-                        break;
-                    }
-                }
-            } else {
-                lastPathIdx = -1;
-            }
-
-            if (lastPathIdx >= pathList.size() ) {
-                lastPathIdx = (unsigned)pathList.size();
-                lastPath = path;
-                pathList.push_back(lastPath);
-            }
+    if (validFile(name, fullname))
+        return addValid(fullname, fullname.length() - name.length(), info);
+    return 0;
+}
 
-            string testPath = pathList[lastPathIdx] + name;
-            if (testPath != fullname) {
-                assert(false);
-            }
-        }
-        fileList[name].push_back(lastPathIdx);
-        fileCount = 1;
+// ---------------------------------------------------------------------------
+size_t DupFiles::addValid(const lstring& fullname, size_t nameOff, const FileInfo& info) {
+    if (! validInfo(info)) {
+        filterCnt++;
+        return 0;
     }
+    fileTable.add(fullname, nameOff, info);
+    if (maxMem != 0 && !justName && !sameName && fileTable.memoryUsed() > maxMem)
+        spillTable();
+    return 1;
+}
 
-    return fileCount;
+// ---------------------------------------------------------------------------
+static size_t fileLength(FileIdx fileIdx) {
+    lstring fullPath;
+    return fileTable.has(fileIdx, INFO_SIZE) ? fileTable.fileSize(fileIdx) : DirUtil::fileLength(fileTable.path(fullPath, fileIdx));
 }
 
-class PathParts {
-public:
-    unsigned pathIdx;
-    const string& name;
-    PathParts(unsigned _pathIdx, const string& _name) :
-        pathIdx(_pathIdx), name(_name) {}
-};
+// ---------------------------------------------------------------------------
+// -all groups by length, empty files (or length unknown) are keyed by path so
+// they never match.
+static uint64_t sizeKey(FileIdx fileIdx) {
+    lstring fullPath;
+    size_t fileLen = fileLength(fileIdx);
+    return (fileLen != 0) ? fileLen : std::hash<std::string> {}(fileTable.path(fullPath, fileIdx));
+}
+
+// ---------------------------------------------------------------------------
+// -all groups by hash, empty files all share one hash so keep them keyed by path.
+static uint64_t hashKey(FileIdx fileIdx, FileIdx hashIdx) {
+    return (fileLength(fileIdx) != 0) ? fileTable.hash(hashIdx) : sizeKey(fileIdx);
+}
+
+// ---------------------------------------------------------------------------
+// Hash files into fileTable, optionally in inode order. With several threads
+// each takes an interleaved share so all progress through inode order together.
+static const unsigned MAX_HASH_THREADS = 8;     // Hasher::compute has 16 buffers
+static void computeHashes(FileIdxList& hashOrder, bool sortInode, unsigned threads) {
+    if (sortInode) {
+        std::stable_sort(hashOrder.begin(), hashOrder.end(),
+            [](FileIdx lhs, FileIdx rhs) { return fileTable.ino(lhs) < fileTable.ino(rhs); });
+    }
+    threads = (unsigned)std::max(std::min((size_t)threads, hashOrder.size()), (size_t)1);
+    GroupSort::parallel(threads, [&](unsigned thread) {
+        lstring fullPath;
+        for (size_t pos = thread; pos < hashOrder.size(); pos += threads) {
+            // HashValue hashValue = Md5::compute(fullPath);
+            fileTable.setHash(hashOrder[pos], Hasher::compute(fileTable.path(fullPath, hashOrder[pos])));
+        }
+    });
+}
+
+// ---------------------------------------------------------------------------
+// Group boundaries of runs of equal names in name sorted order.
+static void groupByName(const FileIdxList& order, std::vector<size_t>& groups) {
+    groups.clear();
+    for (size_t pos = 0; pos < order.size(); pos++) {
+        if (pos == 0 || strcmp(fileTable.name(order[pos - 1]), fileTable.name(order[pos])) != 0)
+            groups.push_back(pos);
+    }
+    groups.push_back(order.size());
+}
 
-void DupFiles::printPaths(const IntList& pathListIdx, const std::string& name) {
-    for (unsigned plIdx = 0; plIdx < pathListIdx.size(); plIdx++) {
-        lstring filePath = absOrRel(pathList[pathListIdx[plIdx]]) + name;
+void DupFiles::printPaths(const FileIdx* files, size_t count) {
+    lstring fullPath;
+    FileInfo info;
+    for (unsigned plIdx = 0; plIdx < count; plIdx++) {
+        lstring filePath = absOrRel(fileTable.path(fullPath, files[plIdx]));
         if (verbose) {
-            print(filePath, NULL);
+            print(filePath, &fileTable.info(info, files[plIdx]));
         } else {
             if (plIdx != 0) std::cout << separator;
             std::cout << filePath;
@@ -411,78 +488,97 @@ bool DupFiles::end() {
     //  missCnt
     //  skipCnt
 
-    if (justName && ignoreExtn) {
-        lstring noExtn;
-        std::map<lstring, std::vector<const string* >> noExtnList;       // TODO - make string& not string
-        for (auto it = fileList.cbegin(); it != fileList.cend(); it++) {
-            const string& fullname = it->first;
-            DirUtil::getName(noExtn, fullname);
-            DirUtil::removeExtn(noExtn, noExtn);
-            noExtnList[noExtn].push_back(&fullname);
-        }
+    if (sizeRuns.runCount() != 0)
+        return endSpilled();
+
+    // Files sorted by name, groups[g] .. groups[g+1] is one name.
+    FileIdxList order;
+    std::vector<size_t> groups;
+    fileTable.sortByName(order);
+    groupByName(order, groups);
+    size_t groupCnt = groups.size() - 1;
 
-        for (auto it = noExtnList.cbegin(); it != noExtnList.cend(); it++) {
-            const string& fullname = *(it->second[0]);
-            if (it->second.size() > 1 || fileList[fullname].size() > 1) {
-                sameCnt += max(1, (int)it->second.size() - 1);
+    if (justName && ignoreExtn) {
+        // Name groups sorted by name without extension, stable so equal keep name order.
+        auto noExtn = [&](size_t gIdx) {
+            std::string_view name(fileTable.name(order[groups[gIdx]]));
+            return name.substr(0, name.rfind('.'));
+        };
+        std::vector<size_t> extnOrder(groupCnt);
+        for (size_t gIdx = 0; gIdx < groupCnt; gIdx++)
+            extnOrder[gIdx] = gIdx;
+        std::stable_sort(extnOrder.begin(), extnOrder.end(), [&](size_t lhs, size_t rhs) {
+            return noExtn(lhs) < noExtn(rhs);
+        });
+
+        for (size_t start = 0, end; start < groupCnt; start = end) {
+            std::string_view key = noExtn(extnOrder[start]);
+            for (end = start + 1; end < groupCnt && noExtn(extnOrder[end]) == key; end++)
+                ;
+            size_t gFirst = extnOrder[start];
+            if (end - start > 1 || groups[gFirst + 1] - groups[gFirst] > 1) {
+                sameCnt += max(1, (int)(end - start) - 1);
                 uint outCnt = 0;
-                for (auto itNames = it->second.cbegin(); itNames != it->second.cend(); itNames++) {
-                    const IntList& pathListIdx = fileList[*(*itNames)];
+                for (size_t pos = start; pos < end; pos++) {
+                    size_t gIdx = extnOrder[pos];
                     if (outCnt++ == 0) 
                         std::cout << preDivider;
                     else 
                         std::cout << separator;
-                    printPaths(pathListIdx, *(*itNames));
+                    printPaths(&order[groups[gIdx]], groups[gIdx + 1] - groups[gIdx]);
                 }
                 std::cout << postDivider;
             }
         }
 
     } else if (justName) {
-        for (auto it = fileList.cbegin(); it != fileList.cend(); it++) {
-            const IntList& pathListIdx = it->second;
-            if (it->second.size() > 1) {
-                sameCnt += it->second.size() - 1;
+        for (size_t gIdx = 0; gIdx < groupCnt; gIdx++) {
+            size_t count = groups[gIdx + 1] - groups[gIdx];
+            if (count > 1) {
+                sameCnt += count - 1;
                 std::cout << preDivider;
-                printPaths(pathListIdx, it->first);
+                printPaths(&order[groups[gIdx]], count);
                 std::cout << postDivider;
             }
         }
     } else if (sameName)  {
-        std::map<HashValue, unsigned> hashDups;
-        std::map<lstring, HashValue> fileHash;
-        for (auto it = fileList.cbegin(); it != fileList.cend(); it++) {
-            const IntList& pathListIdx = it->second;
-            if (it->second.size() > 1) {
-                hashDups.clear();
-                fileHash.clear();
-
-                for (unsigned plIdx = 0; plIdx < pathListIdx.size(); plIdx++) {
-                    // std::cout << pathList[pathListIdx[plIdx]] << it->first << std::endl;
-                    lstring fullPath = pathList[pathListIdx[plIdx]] + it->first;
+        FileGroups hashDups;                // files of one name grouped by hash
+        FileGroups hashFileList;            // dup (or unique when invert) files by hash
+        std::vector<HashValue> hashKeys;
+        FileIdxList hashFiles;
+        std::vector<size_t> hashOrder;
+        lstring fullPath;
+        FileInfo info;
+        for (size_t gIdx = 0; gIdx < groupCnt; gIdx++) {
+            const FileIdx* fileIdxs = &order[groups[gIdx]];
+            size_t count = groups[gIdx + 1] - groups[gIdx];
+            if (count > 1) {
+                hashKeys.resize(count);
+                for (unsigned plIdx = 0; plIdx < count; plIdx++) {
+                    fileTable.path(fullPath, fileIdxs[plIdx]);
                     // HashValue hashValue = Md5::compute(fullPath);
                     HashValue hashValue = Hasher::compute(fullPath);
-                    hashDups[hashValue] = hashDups[hashValue] + 1;
-                    fileHash[fullPath] = hashValue;
+                    hashKeys[plIdx] = hashValue;
+                    fileTable.setHash(fileIdxs[plIdx], hashValue);
                 }
-
-                std::map<HashValue, std::vector<unsigned >> hashFileList;
-                for (unsigned plIdx = 0; plIdx < pathListIdx.size(); plIdx++) {
-                    // std::cout << pathList[pathListIdx[plIdx]] << it->first << std::endl;
-                    unsigned plPos = pathListIdx[plIdx];
-                    lstring fullPath = pathList[plPos] + it->first;
-                    HashValue hashValue = fileHash[fullPath];
-                    bool isDup = (hashDups[hashValue] != 1);
+                hashDups.build(hashKeys.data(), fileIdxs, count);
+
+                hashKeys.clear();
+                hashFiles.clear();
+                for (unsigned plIdx = 0; plIdx < count; plIdx++) {
+                    fileTable.path(fullPath, fileIdxs[plIdx]);
+                    HashValue hashValue = fileTable.hash(fileIdxs[plIdx]);
+                    bool isDup = (hashDups.count(hashDups.find(hashValue)) != 1);
                
                     if (verbose) {
-                        std::cout << (isDup ? preDup : preDiff) << fileHash[fullPath] << " ";
-                        print(fullPath, NULL);
+                        std::cout << (isDup ? preDup : preDiff) << hashValue << " ";
+                        print(fullPath, &fileTable.info(info, fileIdxs[plIdx]));
                       
                         if (isDup) {
                             sameCnt++;
 
                             if (hardlink) {
-                                lstring fullPath2 = pathList[pathListIdx[plIdx]] + it->first;
+                                lstring fullPath2 = fullPath;
                                 LinkStatus status = DirUtil::hardlink(dryRun, fullPath, fullPath2);
                                 DirUtil::showLink(status, fullPath, fullPath2);
                             } else if (ParseUtil::FileMatches(fullPath, delDupPathPatList, false)) {
@@ -491,18 +587,26 @@ bool DupFiles::end() {
                         } else 
                             diffCnt++;
                     } else if (isDup != invert) {
-                        hashFileList[hashValue].push_back(plPos);
+                        hashKeys.push_back(hashValue);
+                        hashFiles.push_back(fileIdxs[plIdx]);
                     }
                 }
 
                 if (! verbose) {
-                    for (auto hashFileListIter = hashFileList.cbegin(); hashFileListIter != hashFileList.cend(); hashFileListIter++) {
-                        if (hashFileListIter->second.size() > 1) {
+                    FileInfo info1, info2;
+                    hashFileList.build(hashKeys.data(), hashFiles.data(), hashFiles.size());
+                    hashFileList.sortByKey(hashOrder);
+                    for (size_t hashGroup : hashOrder) {
+                        size_t matchCnt = hashFileList.count(hashGroup);
+                        if (matchCnt > 1) {
                             std::cout << preDivider;
-                            const auto& matchList = hashFileListIter->second;
+                            const FileIdx* matchList = hashFileList.files(hashGroup);
                             lstring fullPath1;
-                            for (unsigned mIdx = 0; mIdx < matchList.size(); mIdx++) {
-                                lstring fullPath2 = pathList[matchList[mIdx]] + it->first;
+                            fileTable.info(info1, matchList[0]);
+                            for (unsigned mIdx = 0; mIdx < matchCnt; mIdx++) {
+                                FileIdx fileIdx2 = matchList[mIdx];
+                                lstring fullPath2;
+                                fileTable.path(fullPath2, fileIdx2);
                                 if (mIdx != 0)
                                     std::cout << separator;
                                 else
@@ -510,7 +614,7 @@ bool DupFiles::end() {
                                 std::cout << fullPath2;
                                 sameCnt++;
                                 if (hardlink && mIdx > 0) {
-                                    LinkStatus status = DirUtil::hardlink(dryRun, fullPath1, fullPath2);
+                                    LinkStatus status = DirUtil::hardlink(dryRun, fullPath1, fullPath2, &info1, &fileTable.info(info2, fileIdx2));
                                     // DirUtil::showLink(status, fullPath1, fullPath2);
                                 } else if (ParseUtil::FileMatches(fullPath2, delDupPathPatList, false)) {
                                     DirUtil::deleteFile(dryRun, fullPath2);
@@ -522,90 +626,453 @@ bool DupFiles::end() {
                 }
             } else if (invert) {
                 std::cout << preDivider;
-                lstring fullPath = pathList[pathListIdx[0]] + it->first;
-                std::cout << fullPath << postDivider;
+                std::cout << fileTable.path(fullPath, fileIdxs[0]) << postDivider;
             }
         }
+    } else if (radixGroup) {
+        endRadix(order);
     } else {
         // Compare all files by size and hash
         //  1. Create map of file length and name
         //  2. For duplicate file length - compute hash
         //  3. For duplicate hash print
 
-        // 1. Create map of file length and name
-        std::map<size_t, std::vector<PathParts >> sizeFileList;
-        for (auto it = fileList.cbegin(); it != fileList.cend(); it++) {
-            const IntList& pathListIdx = it->second;
-            for (unsigned plIdx = 0; plIdx < pathListIdx.size(); plIdx++) {
-                unsigned plPos = pathListIdx[plIdx];
-                lstring fullPath = pathList[plPos] + it->first;
-                size_t fileLen = DirUtil::fileLength(fullPath);
-                fileLen = (fileLen != 0) ? fileLen : std::hash<std::string> {}(fullPath);
-                const string& name = it->first;
-                PathParts pathParts(plPos, name);
-                sizeFileList[fileLen].push_back(pathParts);
+        // 1. Group files by length
+        FileGroups sizeFileList;
+        std::vector<uint64_t> groupKeys(order.size());
+        for (size_t pos = 0; pos < order.size(); pos++) {
+            groupKeys[pos] = sizeKey(order[pos]);
+        }
+        sizeFileList.build(groupKeys.data(), order.data(), order.size());
+
+        // 2. Compute hash on duplicate length files, once per inode (dev,ino).
+        HashRefList hashRefs;
+        FileIdxList hashOrder;
+        for (size_t sizeGroup = 0; sizeGroup < sizeFileList.size(); sizeGroup++) {
+            addHashRefs(sizeFileList.files(sizeGroup), sizeFileList.count(sizeGroup), hashRefs, hashOrder);
+        }
+        computeHashes(hashOrder, sortInode, 1);
+
+        FileGroups hashFileList;
+        FileIdxList hashFiles(hashRefs.size());
+        groupKeys.resize(hashRefs.size());
+        for (size_t pos = 0; pos < hashRefs.size(); pos++) {
+            groupKeys[pos] = hashKey(hashRefs[pos].fileIdx, hashRefs[pos].hashIdx);
+            hashFiles[pos] = hashRefs[pos].fileIdx;
+        }
+        hashFileList.build(groupKeys.data(), hashFiles.data(), hashFiles.size());
+
+        
+        // 3. Find duplicate hash, groups in hash order
+        std::vector<size_t> hashGroups;
+        hashFileList.sortByKey(hashGroups);
+        for (size_t hashGroup : hashGroups) {
+            size_t matchCnt = hashFileList.count(hashGroup);
+            if ((matchCnt > 1) != invert) {
+                printDupGroup(hashFileList.files(hashGroup), matchCnt);
             }
         }
+    }
+    return true;
+}
 
-        // 2. Compute hash on duplicate length files.
-        std::map<HashValue, std::vector<const PathParts* >> hashFileList;
-        for (auto sizeFileListIter = sizeFileList.cbegin(); sizeFileListIter != sizeFileList.cend(); sizeFileListIter++) {
-            if ((sizeFileListIter->second.size() > 1) != invert) {
-                const auto& sizeList = sizeFileListIter->second;
-                for (unsigned sIdx = 0; sIdx < sizeList.size(); sIdx++) {
-                    const PathParts& pathParts = sizeList[sIdx];
-                    lstring fullPath = pathList[pathParts.pathIdx];
-                    fullPath += pathParts.name;
-                    // HashValue hashValue = Md5::compute(fullPath);
-                    HashValue hashValue = Hasher::compute(fullPath);
-                    hashFileList[hashValue].push_back(&pathParts);
+// ---------------------------------------------------------------------------
+// Same sort of (size, hash, file) tuples as -all, but one flat array sorted
+// in parallel and swept for runs, no hash tables.
+//  1. Sort tuples by size, sweep runs of equal size
+//  2. Hash survivors, once per inode, across threads
+//  3. Sort survivors by (size, hash), sweep runs of equal size and hash
+// Groups are reported in (size, hash) order.
+void DupFiles::endRadix(const FileIdxList& order) {
+    unsigned threads = GroupSort::threadCount(MAX_HASH_THREADS);
+    GroupTuples tuples(order.size());
+    GroupTuples scratch;
+
+    // 1. Sort by size, stable so equal sizes keep name order.
+    for (size_t pos = 0; pos < order.size(); pos++) {
+        tuples[pos] = GroupTuple{sizeKey(order[pos]), 0, order[pos]};
+    }
+    GroupSort::sortBySize(tuples, scratch, threads);
+
+    // 2. Keep files of duplicate size (unique with invert), hash field holds
+    //    file with hash until hashes are computed.
+    HashRefList hashRefs;
+    FileIdxList hashOrder;
+    FileIdxList sizeList;
+    GroupTuples hashTuples;
+    for (size_t start = 0, end; start < tuples.size(); start = end) {
+        uint64_t sizeValue = tuples[start].size;
+        for (end = start + 1; end < tuples.size() && tuples[end].size == sizeValue; end++)
+            ;
+        sizeList.clear();
+        for (size_t pos = start; pos < end; pos++)
+            sizeList.push_back(tuples[pos].fileIdx);
+        hashRefs.clear();
+        addHashRefs(sizeList.data(), sizeList.size(), hashRefs, hashOrder);
+        for (const HashRef& hashRef : hashRefs) {
+            // Empty files stay keyed by path so they never share (size, hash).
+            hashTuples.push_back(GroupTuple{sizeValue, hashRef.hashIdx, hashRef.fileIdx});
+        }
+    }
+    GroupTuples().swap(tuples);
+
+    computeHashes(hashOrder, sortInode, threads);
+    for (GroupTuple& tuple : hashTuples) {
+        tuple.hash = fileTable.hash((FileIdx)tuple.hash);
+    }
+
+    // 3. Sort by (size, hash) and report runs.
+    GroupSort::sortBySizeHash(hashTuples, scratch, threads);
+    GroupTuples().swap(scratch);
+
+    FileIdxList matchList;
+    for (size_t start = 0, end; start < hashTuples.size(); start = end) {
+        for (end = start + 1; end < hashTuples.size()
+                && hashTuples[end].size == hashTuples[start].size
+                && hashTuples[end].hash == hashTuples[start].hash; end++)
+            ;
+        if ((end - start > 1) != invert) {
+            matchList.clear();
+            for (size_t pos = start; pos < end; pos++)
+                matchList.push_back(hashTuples[pos].fileIdx);
+            printDupGroup(matchList.data(), matchList.size());
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Queue each inode of one size group for hashing once. Other paths to the same
+// inode are hard links and reuse the hash, the same path seen again (overlapping
+// roots) is dropped.
+bool DupFiles::addHashRefs(const FileIdx* sizeList, size_t sizeCnt, HashRefList& hashRefs, FileIdxList& hashOrder,
+        bool partOfGroup) {
+    if (sizeCnt < 2 && !partOfGroup) {
+        if (sizeCnt == 0 || !invert)
+            return false;
+        hashRefs.push_back(HashRef{sizeList[0], sizeList[0]});
+        hashOrder.push_back(sizeList[0]);
+        return true;
+    }
+
+    // Files with an inode sorted by (dev, ino, position), each run is one inode.
+    struct InodeRef {
+        uint64_t dev;
+        uint64_t ino;
+        size_t pos;
+        bool operator<(const InodeRef& other) const {
+            return dev != other.dev ? dev < other.dev : ino != other.ino ? ino < other.ino : pos < other.pos;
+        }
+    };
+    static const FileIdx DROP = FileIdx(-1);
+    std::vector<InodeRef> inodeRefs;
+    FileIdxList hashIdxs(sizeList, sizeList + sizeCnt);     // per position, file holding hash or DROP
+    for (size_t sIdx = 0; sIdx < sizeCnt; sIdx++) {
+        FileIdx fileIdx = sizeList[sIdx];
+        if (fileTable.has(fileIdx, INFO_ID) && fileTable.ino(fileIdx) != 0)
+            inodeRefs.push_back(InodeRef{fileTable.dev(fileIdx), fileTable.ino(fileIdx), sIdx});
+    }
+    std::sort(inodeRefs.begin(), inodeRefs.end());
+
+    for (size_t start = 0, end; start < inodeRefs.size(); start = end) {
+        for (end = start + 1; end < inodeRefs.size()
+                && inodeRefs[end].dev == inodeRefs[start].dev && inodeRefs[end].ino == inodeRefs[start].ino; end++)
+            ;
+        FileIdx firstIdx = sizeList[inodeRefs[start].pos];
+        for (size_t link = start + 1; link < end; link++) {
+            FileIdx fileIdx = sizeList[inodeRefs[link].pos];
+            hashIdxs[inodeRefs[link].pos] = firstIdx;
+            for (size_t prev = start; prev < link; prev++) {
+                if (hashIdxs[inodeRefs[prev].pos] != DROP && fileTable.samePath(fileIdx, sizeList[inodeRefs[prev].pos])) {
+                    hashIdxs[inodeRefs[link].pos] = DROP;   // same path from overlapping roots
+                    break;
                 }
             }
         }
+    }
 
-        
-        // 3. Find duplicate hash
-        for (auto hashFileListIter = hashFileList.cbegin(); hashFileListIter != hashFileList.cend(); hashFileListIter++) {
-            if ((hashFileListIter->second.size() > 1) != invert) {
-                lstring fullPath1;
-                sameCnt += hashFileListIter->second.size() - 1;
-                if (showSame) std::cout << preDup;
-                const auto& matchList = hashFileListIter->second;
-                for (unsigned mIdx = 0; mIdx < matchList.size(); mIdx++) {
-                    const PathParts& pathParts = *matchList[mIdx];
-                    lstring fullPath2 = pathList[pathParts.pathIdx];
-                    fullPath2 += pathParts.name;
-                    if (verbose) {
-                        std::cout << std::endl;
-                        if (mIdx == matchList.size() - 1)
-                            std::cout << "last;";
-                        else
-                            std::cout << mIdx << ";";
-                        std::cout << absOrRel(fullPath2);
-                        // std::cout <<  matchList.size() << " Hash " << hashFileListIter->first << " ";
-                        // print(fullPath2, NULL);
-                    } else if (showSame) {
-                        if (mIdx != 0) std::cout << separator;
-                        std::cout << absOrRel(fullPath2);
-                    }
-                    if (hardlink) {
-                        if (mIdx == 0) {
-                            fullPath1 = fullPath2;
-                        } else {
-                            LinkStatus status = DirUtil::hardlink(dryRun, fullPath1, fullPath2);
-                            if (verbose) DirUtil::showLink(status, fullPath1, fullPath2);
-                        }
-                    } else if (ParseUtil::FileMatches(fullPath2, delDupPathPatList, false)) {
-                        DirUtil::deleteFile(dryRun, fullPath2);
-                    } 
-                }
-                if (showSame)std::cout << postDivider;
+    size_t keepCnt = sizeCnt - std::count(hashIdxs.begin(), hashIdxs.end(), DROP);
+    if ((keepCnt > 1 || partOfGroup) == invert)
+        return false;
+
+    lstring fullPath;
+    for (size_t sIdx = 0; sIdx < sizeCnt; sIdx++) {
+        FileIdx fileIdx = sizeList[sIdx];
+        FileIdx hashIdx = hashIdxs[sIdx];
+        if (hashIdx == fileIdx) {
+            hashRefs.push_back(HashRef{fileIdx, fileIdx});
+            hashOrder.push_back(fileIdx);
+        } else if (hashIdx != DROP) {
+            linkCnt++;
+            if (verbose) {
+                lstring firstPath;
+                Colors::showError("Linked:", fileTable.path(fullPath, fileIdx).c_str(), fileTable.path(firstPath, hashIdx).c_str());
+            }
+            if (! ignoreHardLinks)
+                hashRefs.push_back(HashRef{fileIdx, hashIdx});
+        }
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Report one group of identical files, link or delete duplicates.
+void DupFiles::printDupGroup(const FileIdx* matchList, size_t matchCnt) {
+    FileInfo info1, info2;
+    lstring fullPath1;
+    sameCnt += matchCnt - 1;
+    if (showSame) std::cout << preDup;
+    for (unsigned mIdx = 0; mIdx < matchCnt; mIdx++) {
+        FileIdx fileIdx = matchList[mIdx];
+        lstring fullPath2;
+        fileTable.path(fullPath2, fileIdx);
+        if (verbose) {
+            std::cout << std::endl;
+            if (mIdx == matchCnt - 1)
+                std::cout << "last;";
+            else
+                std::cout << mIdx << ";";
+            std::cout << absOrRel(fullPath2);
+            // print(fullPath2, NULL);
+        } else if (showSame) {
+            if (mIdx != 0) std::cout << separator;
+            std::cout << absOrRel(fullPath2);
+        }
+        if (hardlink) {
+            if (mIdx == 0) {
+                fullPath1 = fullPath2;
+                fileTable.info(info1, fileIdx);
+            } else {
+                LinkStatus status = DirUtil::hardlink(dryRun, fullPath1, fullPath2, &info1, &fileTable.info(info2, fileIdx));
+                if (verbose) DirUtil::showLink(status, fullPath1, fullPath2);
             }
+        } else if (ParseUtil::FileMatches(fullPath2, delDupPathPatList, false)) {
+            DirUtil::deleteFile(dryRun, fullPath2);
+        } 
+    }
+    if (showSame)std::cout << postDivider;
+}
+
+// ---------------------------------------------------------------------------
+// Write table as one run ordered by (keys, hash), equal keys keep table order.
+static bool writeRun(SpillRuns& runs, const FileTable& table, const std::vector<uint64_t>& keys) {
+    FileIdxList order(table.size());
+    for (size_t idx = 0; idx < order.size(); idx++)
+        order[idx] = (FileIdx)idx;
+    std::stable_sort(order.begin(), order.end(), [&](FileIdx lhs, FileIdx rhs) {
+        return keys[lhs] != keys[rhs] ? keys[lhs] < keys[rhs] : table.hash(lhs) < table.hash(rhs);
+    });
+
+    if (! runs.beginRun())
+        return false;
+    SpillRecord record;
+    for (FileIdx fileIdx : order) {
+        record.size = keys[fileIdx];
+        record.hash = table.hash(fileIdx);
+        table.info(record.info, fileIdx);
+        table.path(record.path, fileIdx);
+        if (! runs.write(record)) {
+            runs.dropRun();
+            return false;
         }
     }
     return true;
 }
 
+// ---------------------------------------------------------------------------
+static void addPath(FileTable& table, const lstring& fullPath, const FileInfo& info) {
+    lstring name;
+    DirUtil::getName(name, fullPath);
+    table.add(fullPath, fullPath.length() - name.length(), info);
+}
+
+// ---------------------------------------------------------------------------
+// Name pool block, a small slice of -maxMem so the first add does not use most of it.
+size_t DupFiles::poolBlockSize() const {
+    return (maxMem != 0) ? maxMem / 16 : StringPool::MAX_BLOCK_SIZE;
+}
+
+// ---------------------------------------------------------------------------
+// Same inode gives same key so hard links and repeated paths sort together.
+static uint64_t inodeKey(const FileTable& table, FileIdx fileIdx) {
+    if (! table.has(fileIdx, INFO_ID) || table.ino(fileIdx) == 0)
+        return 0;
+    return (table.dev(fileIdx) * 0x9e3779b97f4a7c15ULL) ^ table.ino(fileIdx);
+}
+
+// ---------------------------------------------------------------------------
+// File table over -maxMem, move it to a run sorted by size and start empty.
+// Without temp space keep going in memory.
+bool DupFiles::spillTable() {
+    std::vector<uint64_t> keys(fileTable.size());
+    for (size_t idx = 0; idx < keys.size(); idx++)
+        keys[idx] = sizeKey((FileIdx)idx);
+    if (! writeRun(sizeRuns, fileTable, keys)) {
+        Colors::showError("Unable to write temporary file, -maxMem ignored");
+        maxMem = 0;
+        return false;
+    }
+    fileTable = FileTable();     // release capacity
+    fileTable.clear(infoNeed() == INFO_ALL, poolBlockSize());
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// -all over spilled runs, memory holds one size or hash group at a time
+// plus a hash table up to half of -maxMem.
+//  1. Merge size runs, hash each duplicate size group, spill (size, hash) runs
+//     A size group over half of -maxMem is spilled to sub-runs ordered by inode
+//     and hashed in chunks, a chunk never splits the paths of one inode.
+//  2. Merge hash runs, report each duplicate (size, hash) group
+// Groups are reported in (size, hash) order.
+bool DupFiles::endSpilled() {
+    if (fileTable.size() != 0 && ! spillTable())
+        return false;
+
+    bool keepFullInfo = (infoNeed() == INFO_ALL);
+    size_t poolBlock = poolBlockSize();
+    SpillRuns hashRuns;
+    FileTable hashTable;
+    std::vector<uint64_t> hashKeys;     // real length per hashTable file
+    // Empty table, release drops capacity left by a large group.
+    auto clearTable = [&](FileTable& table, bool release) {
+        if (release)
+            table = FileTable();
+        table.clear(keepFullInfo, poolBlock);
+    };
+    clearTable(hashTable, false);
+    clearTable(fileTable, false);
+
+    // 1. fileTable holds one size group, or one chunk of it.
+    HashRefList hashRefs;
+    FileIdxList hashOrder;
+    FileIdxList groupList;
+    lstring fullPath;
+    FileInfo info;
+    bool spillOk = true;
+    auto hashGroup = [&](uint64_t sizeValue, bool chunk) {
+        fileTable.sortByName(groupList);        // same member order as in memory -all
+        hashRefs.clear();
+        hashOrder.clear();
+        // Chunk is part of a large group.
+        if (addHashRefs(groupList.data(), groupList.size(), hashRefs, hashOrder, chunk)) {
+            computeHashes(hashOrder, sortInode, 1);
+            for (const HashRef& hashRef : hashRefs) {
+                addPath(hashTable, fileTable.path(fullPath, hashRef.fileIdx), fileTable.info(info, hashRef.fileIdx));
+                hashTable.setHash((FileIdx)(hashTable.size() - 1), fileTable.hash(hashRef.hashIdx));
+                // Empty files stay keyed by path so they never share (size, hash).
+                hashKeys.push_back(sizeValue);
+            }
+            if (hashTable.memoryUsed() > maxMem / 2) {
+                spillOk = spillOk && writeRun(hashRuns, hashTable, hashKeys);
+                clearTable(hashTable, true);
+                hashKeys.clear();
+            }
+        }
+        clearTable(fileTable, chunk);
+    };
+
+    // Size group too large for memory, sub-runs keyed by inode.
+    SpillRuns groupRuns;
+    std::vector<uint64_t> inodeKeys;
+    auto spillGroup = [&]() {
+        inodeKeys.resize(fileTable.size());
+        for (size_t idx = 0; idx < inodeKeys.size(); idx++)
+            inodeKeys[idx] = inodeKey(fileTable, (FileIdx)idx);
+        spillOk = spillOk && writeRun(groupRuns, fileTable, inodeKeys);
+        clearTable(fileTable, true);
+    };
+    auto endGroup = [&](uint64_t sizeValue) {
+        if (groupRuns.runCount() == 0) {
+            hashGroup(sizeValue, false);
+            return;
+        }
+        if (fileTable.size() != 0)
+            spillGroup();
+        uint64_t lastKey = 0;
+        bool chunkOk = groupRuns.merge([&](const SpillRecord& record) {
+            if (fileTable.size() != 0 && record.size != lastKey && fileTable.memoryUsed() > maxMem / 2)
+                hashGroup(sizeValue, true);
+            lastKey = record.size;
+            addPath(fileTable, record.path, record.info);
+        });
+        spillOk = spillOk && chunkOk;
+        if (fileTable.size() != 0)
+            hashGroup(sizeValue, true);
+        groupRuns.clear();
+    };
+
+    uint64_t groupKey = 0;
+    bool mergeOk = sizeRuns.merge([&](const SpillRecord& record) {
+        if ((fileTable.size() != 0 || groupRuns.runCount() != 0) && record.size != groupKey)
+            endGroup(groupKey);
+        groupKey = record.size;
+        addPath(fileTable, record.path, record.info);
+        if (fileTable.memoryUsed() > maxMem / 2)
+            spillGroup();
+    });
+    if (fileTable.size() != 0 || groupRuns.runCount() != 0)
+        endGroup(groupKey);
+    spillOk = spillOk && writeRun(hashRuns, hashTable, hashKeys);
+    hashTable = FileTable();
+    if (! mergeOk || ! spillOk) {
+        Colors::showError("Failed reading or writing temporary files, -maxMem");
+        return false;
+    }
+
+    // 2. fileTable holds one hash group.
+    auto reportGroup = [&]() {
+        size_t matchCnt = fileTable.size();
+        if ((matchCnt > 1) != invert) {
+            fileTable.sortByName(groupList);
+            printDupGroup(groupList.data(), matchCnt);
+        }
+        clearTable(fileTable, false);
+    };
+
+    uint64_t groupHash = 0;
+    mergeOk = hashRuns.merge([&](const SpillRecord& record) {
+        if (fileTable.size() != 0 && (record.size != groupKey || record.hash != groupHash))
+            reportGroup();
+        groupKey = record.size;
+        groupHash = record.hash;
+        addPath(fileTable, record.path, record.info);
+    });
+    if (fileTable.size() != 0)
+        reportGroup();
+    if (! mergeOk)
+        Colors::showError("Failed reading temporary files, -maxMem");
+    return mergeOk;
+}
+
+//-------------------------------------------------------------------------------------------------
+// [static] parse size with optional k, m or g suffix (1024 based), ex: 10m
+bool Command::getSize(size_t& size, const char* str) {
+    char* endPtr;
+    double value = strtod(str, &endPtr);
+    if (endPtr == str || value < 0)
+        return false;
+    switch (tolower(*endPtr)) {
+    case 'g': value *= 1024;    // fall through
+    case 'm': value *= 1024;    // fall through
+    case 'k': value *= 1024;
+        endPtr++;
+        break;
+    }
+    size = (size_t)value;
+    return *endPtr == '\0';
+}
+
+//-------------------------------------------------------------------------------------------------
+// [static] parse non-negative number, fail on trailing text or above maxNumber
+bool Command::getNumber(double& number, const char* str, double maxNumber) {
+    char* endPtr;
+    double value = strtod(str, &endPtr);
+    if (endPtr == str || *endPtr != '\0' || !(value >= 0) || value > maxNumber)
+        return false;
+    number = value;
+    return true;
+}
+
 //-------------------------------------------------------------------------------------------------
 // [static] parse FileTypes from string
 bool Command::getFileTypes(Command::FileTypes &fileTypes, const char *str) {
@@ -629,8 +1096,22 @@ bool Command::getFileTypes(Command::FileTypes &fileTypes, const char *str) {
 
 
 // ---------------------------------------------------------------------------
-void Command::showDuplicate(const lstring& filePath1, const lstring& filePath2)  {
+void Command::showDuplicate(const lstring& filePath1, const lstring& filePath2,
+        const FileInfo* info1, const FileInfo* info2)  {
     sameCnt++;
+    if (Reporter::isRunning()) {
+        Report* report = new Report(Report::DUP, *this, filePath1, filePath2);
+        if (info1 != nullptr) report->info1 = *info1;
+        if (info2 != nullptr) report->info2 = *info2;
+        Reporter::post(report);
+    } else {
+        reportDuplicate(filePath1, filePath2, info1, info2);
+    }
+}
+
+// ---------------------------------------------------------------------------
+void Command::reportDuplicate(const lstring& filePath1, const lstring& filePath2,
+        const FileInfo* info1, const FileInfo* info2)  {
     if (showSame) {
         std::cout << preDup;
         if (showFiles == Command::Both || showFiles == Command::First)
@@ -642,7 +1123,7 @@ void Command::showDuplicate(const lstring& filePath1, const lstring& filePath2)
         std::cout << postDivider;
 
         if (hardlink) {
-            LinkStatus status = DirUtil::hardlink(dryRun, filePath1, filePath2);
+            LinkStatus status = DirUtil::hardlink(dryRun, filePath1, filePath2, info1, info2);
             if (verbose)
                 DirUtil::showLink(status, filePath1, filePath2);
         } else if (deleteFiles != Command::None) {
@@ -666,9 +1147,17 @@ void Command::showDuplicate(const lstring& filePath1, const lstring& filePath2)
 
 // ---------------------------------------------------------------------------
 void Command::showDifferent(const lstring& filePath1, const lstring& filePath2)  {
+    diffCnt++;
+    if (Reporter::isRunning())
+        Reporter::post(new Report(Report::DIFF, *this, filePath1, filePath2));
+    else
+        reportDifferent(filePath1, filePath2);
+}
+
+// ---------------------------------------------------------------------------
+void Command::reportDifferent(const lstring& filePath1, const lstring& filePath2)  {
     // TODO - add ability to delete different files, similar to dup files
     
-    diffCnt++;
     if (showDiff) {
         std::cout << preDiff;
         if (showFiles != Command::Second)
@@ -683,9 +1172,17 @@ void Command::showDifferent(const lstring& filePath1, const lstring& filePath2)
 
 // ---------------------------------------------------------------------------
 void Command::showMissing(bool have1, const lstring& filePath1, bool have2, const lstring& filePath2)  {
+    missCnt++;
+    if (Reporter::isRunning())
+        Reporter::post(new Report(Report::MISS, *this, filePath1, filePath2, have1, have2));
+    else
+        reportMissing(have1, filePath1, have2, filePath2);
+}
+
+// ---------------------------------------------------------------------------
+void Command::reportMissing(bool have1, const lstring& filePath1, bool have2, const lstring& filePath2)  {
     // TODO - add ability to delete different files, similar to dup files
     
-    missCnt++;
     if (showMiss) {
         std::cout << preMissing;
         if (have1 != invert)
@@ -695,3 +1192,52 @@ void Command::showMissing(bool have1, const lstring& filePath1, bool have2, cons
         std::cout << postDivider;
     }
 }
+
+// ---------------------------------------------------------------------------
+// Few roots, count identical copies pairwise. Copies never hashed have a
+// unique size among roots so they only match themselves.
+void Command::showVote(const StringList& filePaths, const std::vector<bool>& haves,
+        const std::vector<uint64_t>& sizes, const std::vector<uint64_t>& hashes) {
+    unsigned roots = (unsigned)filePaths.size();
+    unsigned votes = 0;
+    size_t winner = 0;
+    for (size_t idx = 0; idx < roots; idx++) {
+        if (! haves[idx])
+            continue;
+        unsigned same = 0;
+        for (size_t other = 0; other < roots; other++) {
+            if (haves[other] && sizes[other] == sizes[idx] && hashes[other] == hashes[idx])
+                same++;
+        }
+        if (same > votes) {
+            votes = same;
+            winner = idx;
+        }
+    }
+
+    if (votes == roots) {
+        agreeCnt++;
+        return;
+    }
+    if (votes * 2 > roots)
+        majorityCnt++;
+    else
+        splitCnt++;
+
+    if (Reporter::isRunning()) {
+        Report* report = new Report(Report::VOTE, *this, filePaths[winner], filePaths[winner]);
+        report->votes = votes;
+        report->roots = roots;
+        Reporter::post(report);
+    } else {
+        reportVote(filePaths[winner], votes, roots);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Path is a copy held by the largest group of identical roots.
+void Command::reportVote(const lstring& filePath, unsigned votes, unsigned roots) {
+    if (showDiff || showMiss) {
+        std::cout << preVote << votes << "/" << roots << " " << filePath << postDivider;
+    }
+}
@@ -49,6 +49,9 @@
 #pragma once
 #include "ll_stdhdr.hpp"
 #include "lstring.hpp"
+#include "directory.hpp"    // FileInfo
+#include "filetable.hpp"    // FileIdx
+#include "spillruns.hpp"
 
 #include <vector>
 #include <regex>
@@ -78,6 +81,12 @@ public:
     bool justName = false;
     bool ignoreExtn = false;
     bool useThreads = false;    // threads slower on physical disks
+    bool largeFirst = false;    // with threads, hash largest files first (LPT scheduling)
+    bool useDirFd = false;      // -all opens sub directories with openat, files still hashed by path
+    bool useBfs = false;        // traverse breadth first, default depth first
+    bool useDfs = false;        // directory compare depth first, default level by level
+    bool sortInode = false;     // stat and hash in inode order, less seeking on cold cache
+    bool radixGroup = false;    // -all groups by parallel radix sort of (size, hash) tuples
     bool dryRun = false;        // -n scan and report but do not delete or hardline. 
     bool showAbsPath = false;
     bool showProgress = false;
@@ -96,6 +105,31 @@ public:
     size_t diffCnt = 0;
     size_t missCnt = 0;
     size_t skipCnt = 0;       // exclude and include filters rejected file.
+    size_t pruneCnt = 0;      // exclude filters rejected directory, subtree not scanned.
+    size_t readCnt = 0;       // directory entries enumerated, pruned subtrees add none.
+    size_t linkCnt = 0;       // paths sharing an inode already seen, not hashed again.
+    size_t filterCnt = 0;     // size or time predicates rejected file.
+    size_t sharedCnt = 0;     // directory scan, copies sharing inode or extents, not read.
+
+    // Scan of more than two directories, one vote per file across roots.
+    size_t agreeCnt = 0;      // every root holds identical copy
+    size_t majorityCnt = 0;   // more than half of roots identical
+    size_t splitCnt = 0;      // no majority
+
+    // Metadata predicates, evaluated before file is stored or hashed.
+    size_t minSize = 0;
+    size_t maxSize = 0;       // 0 = no limit
+    time_t newerTime = 0;     // keep files modified after, 0 = no limit
+    time_t olderTime = 0;     // keep files modified before, 0 = no limit
+
+    size_t maxMem = 0;        // -all spills file table to sorted runs above this, 0 = no limit
+
+    // Directory scan, -quick treats same size and mtime as identical (no read).
+    bool quick = false;
+    double quickSample = 0;   // percent of quick files content verified anyway
+    time_t quickSkew = 0;     // mtimes this close (seconds) are verified, not different
+    size_t quickCnt = 0;      // files decided by size and mtime
+    size_t verifyCnt = 0;     // quick files content verified
 
     lstring separator = ", ";
     lstring preDivider = "";
@@ -104,9 +138,10 @@ public:
     lstring preDup = "== ";
     lstring preMissing = "-- ";
     lstring preDiff = "!= ";
+    lstring preVote = "?? ";
 
+    bool ignoreHardLinks = false;   // -all report one path per inode
     // TODO - not yet implemented
-    bool ignoreHardLinks = false;
     bool ignoreSoftLinks = false;
     bool hardlink = false;      // If dup, hardlink
 
@@ -121,13 +156,40 @@ public:
         return fileDirList.size() > 0;
     }
 
-    virtual size_t add(const lstring& file) = 0;
+    // Add file with metadata captured during traversal, see info.have for fields captured.
+    virtual size_t add(const lstring& file, const FileInfo& info) = 0;
+    // Same, name at nameOff already passed validFile.
+    virtual size_t addValid(const lstring& file, size_t nameOff, const FileInfo& info) = 0;
 
     virtual bool end() {
         return true;
     }
 
     bool validFile(const lstring &name, const lstring &fullname);
+    bool validDir(const lstring &name, const lstring &fullname);
+    bool validInfo(const FileInfo& info) const;
+    bool hasPathPatterns() const {
+        return !excludePathPatList.empty() || !includePathPatList.empty();
+    }
+    bool hasPredicates() const {
+        return minSize != 0 || maxSize != 0 || newerTime != 0 || olderTime != 0;
+    }
+
+    // File metadata scan must capture, InfoNeed bits.
+    unsigned infoNeed() const {
+        if (verbose || hardlink)
+            return INFO_ALL;
+        unsigned need = INFO_NONE;
+        if (!justName && !sameName)
+            need |= INFO_SIZE | INFO_ID;   // -all groups by size, hashes once per inode
+        if (minSize != 0 || maxSize != 0)
+            need |= INFO_SIZE;
+        if (newerTime != 0 || olderTime != 0)
+            need |= INFO_TIME;
+        if (quick)
+            need |= INFO_SIZE | INFO_TIME;
+        return need;
+    }
 
     Command& share(const Command& other) {
         includeFilePatList = other.includeFilePatList;
@@ -141,17 +203,38 @@ public:
         separator = other.separator;
         preDivider = other.preDivider;
         postDivider = other.postDivider;
+        minSize = other.minSize;
+        maxSize = other.maxSize;
+        newerTime = other.newerTime;
+        olderTime = other.olderTime;
         return *this;
     }
 
     static bool getFileTypes(FileTypes& fileTypes, const char *str);
+    static bool getSize(size_t& size, const char* str);
+    static bool getNumber(double& number, const char* str, double maxNumber);
 
     const char* absOrRel(const char* fullPath) const;
     const char* absOrRel(const string& fullPath) const;
+    std::string_view absOrRel(std::string_view fullPath) const;
 
-    void showDuplicate(const lstring& filePath1, const lstring& filePath2);
+    // Count result and output it, via reporter thread when running.
+    void showDuplicate(const lstring& filePath1, const lstring& filePath2,
+            const FileInfo* info1 = nullptr, const FileInfo* info2 = nullptr);
     void showDifferent(const lstring& filePath1, const lstring& filePath2);
     void showMissing(bool have1, const lstring & filePath1, bool have2, const lstring& filePath2);
+
+    // One file in each root, copies identical when present with same size and hash.
+    // Counts agree, majority or split and shows file unless every root agrees.
+    void showVote(const StringList& filePaths, const std::vector<bool>& haves,
+            const std::vector<uint64_t>& sizes, const std::vector<uint64_t>& hashes);
+
+    // Output result and perform link/delete actions, called by owner of stdout.
+    void reportDuplicate(const lstring& filePath1, const lstring& filePath2,
+            const FileInfo* info1 = nullptr, const FileInfo* info2 = nullptr);
+    void reportDifferent(const lstring& filePath1, const lstring& filePath2);
+    void reportMissing(bool have1, const lstring & filePath1, bool have2, const lstring& filePath2);
+    void reportVote(const lstring& filePath, unsigned votes, unsigned roots);
 };
 
 
@@ -161,9 +244,32 @@ class DupFiles : public Command {
 public:
     DupFiles() : Command('f') {}
     virtual  bool begin(StringList& fileDirList);
-    virtual size_t add(const lstring& file);
+    virtual size_t add(const lstring& file, const FileInfo& info);
+    virtual size_t addValid(const lstring& file, size_t nameOff, const FileInfo& info);
     virtual bool end();
 
-    void printPaths(const IntList& pathListIdx, const std::string& name);
+    void printPaths(const FileIdx* files, size_t count);
+
+private:
+    struct HashRef {
+        FileIdx fileIdx;
+        FileIdx hashIdx;        // file holding hash, differs for hard links
+    };
+    typedef std::vector<HashRef> HashRefList;
+
+    // Files of one size which need a hash, hard links reference first path of inode.
+    // Nothing queued, returns false, if after dropping repeated paths the group
+    // is a single file (or not single with invert), partOfGroup counts as several.
+    bool addHashRefs(const FileIdx* sizeList, size_t sizeCnt, HashRefList& hashRefs, FileIdxList& hashOrder,
+            bool partOfGroup = false);
+    void printDupGroup(const FileIdx* matchList, size_t matchCnt);
+    void endRadix(const FileIdxList& order);
+
+    // -maxMem, file table spilled to runs sorted by size, then merged.
+    static constexpr size_t MIN_MAX_MEM = 1 << 20;     // below this runs hold a few files each
+    SpillRuns sizeRuns;
+    size_t poolBlockSize() const;
+    bool spillTable();
+    bool endSpilled();
 };
 
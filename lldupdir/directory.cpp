@@ -80,6 +80,12 @@ Directory_files::Directory_files(const lstring& dirName) :
     my_dirName(dirName) {
 }
 
+//-------------------------------------------------------------------------------------------------
+Directory_files::Directory_files(const Directory_files& parent, const char* subDirName) :
+    my_dir_hnd(INVALID_HANDLE_VALUE),
+    my_dirName(parent.my_dirName + SLASH + subDirName) {
+}
+
 //-------------------------------------------------------------------------------------------------
 Directory_files::~Directory_files() {
     if (my_dir_hnd != INVALID_HANDLE_VALUE)
@@ -164,6 +170,12 @@ const lstring& Directory_files::fullName(lstring& fname) const {
     return GetFullPath(fname);
 }
 
+//-------------------------------------------------------------------------------------------------
+bool Directory_files::getInfo(FileInfo& info, unsigned need) const {
+    lstring fname;
+    return DirUtil::getInfo(info, fullName(fname));
+}
+
 #else   // else not windows below
 
 #include <unistd.h>
@@ -173,8 +185,47 @@ const lstring Directory_files::SLASH = "/";
 const char Directory_files::SLASH_CHAR = '/';
 const lstring Directory_files::SLASH2 = "//";
 
+#include <fcntl.h>
+#include <algorithm>
+
+#ifdef HAVE_STATX
+#include <sys/vfs.h>        // fstatfs
+#include <sys/sysmacros.h>  // makedev
+#endif
+
+#ifdef HAVE_FIEMAP
+#include <sys/ioctl.h>
+#include <linux/fs.h>       // FS_IOC_FIEMAP
+#include <linux/fiemap.h>
+#include <sys/vfs.h>        // statfs
+#include <string.h>         // memset
+#endif
+
+#ifdef HAVE_GETDENTS
+#include <sys/syscall.h>
+
+// Record returned by getdents64, not exported by glibc headers.
+struct linux_dirent64 {
+    ino64_t        d_ino;
+    off64_t        d_off;
+    unsigned short d_reclen;
+    unsigned char  d_type;
+    char           d_name[];
+};
+#endif
+
+// getdents64 buffer starts small, doubles while reads fill it (large directory).
+static const size_t DIR_BUFFER_MIN = 64 * 1024;
+static const size_t DIR_BUFFER_SIZE = 1024 * 1024;
+
 //-------------------------------------------------------------------------------------------------
-Directory_files::Directory_files(const lstring& dirName) {
+// Return true if name is "." or ".."
+inline static bool isDotDir(const char* name) {
+    return name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+}
+
+//-------------------------------------------------------------------------------------------------
+Directory_files::Directory_files(const lstring& dirName) : my_batchIdx(0), my_sortInode(false) {
     if (!DirUtil::fileExists(dirName)) {
         // Remove any wildcard are extra characters.
         DirUtil::getDir(my_baseDir, dirName);
@@ -183,47 +234,188 @@ Directory_files::Directory_files(const lstring& dirName) {
         realpath(dirName.c_str(), my_fullname);
     }
     my_baseDir = my_fullname;
+#ifdef HAVE_GETDENTS
+    my_dirFd = open(my_baseDir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    my_is_more = (my_dirFd != -1);
+#else
     my_pDir = opendir(my_baseDir);
     my_is_more = (my_pDir != NULL);
+#endif
+    my_statFlags = (my_is_more && DirUtil::isNetworkFs(dirFd())) ? AT_STATX_DONT_SYNC : 0;
+}
+
+//-------------------------------------------------------------------------------------------------
+Directory_files::Directory_files(const Directory_files& parent, const char* subDirName) :
+        my_batchIdx(0), my_statFlags(parent.my_statFlags), my_sortInode(parent.my_sortInode) {
+    my_baseDir.assign(parent.my_baseDir);
+    DirUtil::appendName(my_baseDir, subDirName);
+    my_fullname[0] = '\0';
+    int fd = parent.dirFd();
+    fd = (fd != -1) ? openat(fd, subDirName, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC) : -1;
+#ifdef HAVE_GETDENTS
+    my_dirFd = fd;
+    my_is_more = (my_dirFd != -1);
+#else
+    my_pDir = (fd != -1) ? fdopendir(fd) : NULL;
+    if (my_pDir == NULL && fd != -1)
+        ::close(fd);
+    my_is_more = (my_pDir != NULL);
+#endif
 }
 
 //-------------------------------------------------------------------------------------------------
 Directory_files::~Directory_files() {
+    close();
+}
+
+//-------------------------------------------------------------------------------------------------
+int Directory_files::dirFd() const {
+#ifdef HAVE_GETDENTS
+    return my_dirFd;
+#else
+    return (my_pDir != NULL) ? dirfd(my_pDir) : -1;
+#endif
+}
+
+//-------------------------------------------------------------------------------------------------
+void Directory_files::close() {
+#ifdef HAVE_GETDENTS
+    if (my_dirFd != -1)
+        ::close(my_dirFd);
+    my_dirFd = -1;
+#else
     if (my_pDir != NULL)
         closedir(my_pDir);
+    my_pDir = NULL;
+#endif
+    my_is_more = false;
+    my_batch.clear();
+    my_batchIdx = 0;
 }
 
 //-------------------------------------------------------------------------------------------------
-bool Directory_files::more() {
-    if (my_is_more) {
-        my_pDirEnt = readdir(my_pDir);
-        my_is_more = my_pDirEnt != NULL;
-        if (my_is_more) {
-            if (my_pDirEnt->d_type == DT_DIR) {
-                while (my_is_more &&
-                (my_pDirEnt->d_name[0] == '.' && ! isalnum(my_pDirEnt->d_name[1]))) {
-                    more();
-                }
+// Rewind and position before first entry, return true if any entries.
+bool Directory_files::begin() {
+#ifdef HAVE_GETDENTS
+    my_is_more = (my_dirFd != -1 && lseek(my_dirFd, 0, SEEK_SET) == 0);
+#else
+    if (my_pDir != NULL)
+        rewinddir(my_pDir);
+    my_is_more = (my_pDir != NULL);
+#endif
+    my_batch.clear();
+    my_batchIdx = 0;
+    if (readBatch()) {
+        my_batchIdx = size_t(-1);   // more() advances to first entry
+        return true;
+    }
+    return false;
+}
+
+//-------------------------------------------------------------------------------------------------
+// Fill batch with next group of entries, skip dot directories.
+bool Directory_files::nextBatch(DirBatch& batch) {
+    batch.clear();
+    while (my_is_more && batch.empty()) {
+#ifdef HAVE_GETDENTS
+        if (my_buffer.empty())
+            my_buffer.resize(DIR_BUFFER_MIN);
+        else if (my_bufferFull && my_buffer.size() < DIR_BUFFER_SIZE)
+            my_buffer.resize(my_buffer.size() * 2);
+        long nread = syscall(SYS_getdents64, my_dirFd, my_buffer.data(), my_buffer.size());
+        if (nread <= 0) {
+            my_is_more = false;
+            break;
+        }
+        my_bufferFull = (size_t)nread > my_buffer.size() / 2;
+        for (long pos = 0; pos < nread; ) {
+            const linux_dirent64* pEnt = (const linux_dirent64*)(my_buffer.data() + pos);
+            pos += pEnt->d_reclen;
+            if (! isDotDir(pEnt->d_name)) {
+                DirEntryInfo info;
+                info.ino = pEnt->d_ino;
+                info.type = pEnt->d_type;
+                info.nameLen = (unsigned short)strlen(pEnt->d_name);
+                info.name = pEnt->d_name;
+                batch.push_back(info);
             }
         }
+#else
+        // Copy names so pointers stay valid across readdir calls.
+        my_buffer.clear();
+        size_t bytes = 0;
+        Dirent* pDirEnt;
+        while (bytes < DIR_BUFFER_SIZE && (pDirEnt = readdir(my_pDir)) != NULL) {
+            if (! isDotDir(pDirEnt->d_name)) {
+                DirEntryInfo info;
+                info.ino = pDirEnt->d_ino;
+                info.type = pDirEnt->d_type;
+                info.nameLen = (unsigned short)strlen(pDirEnt->d_name);
+                info.name = (const char*)bytes;     // offset, fixed up below
+                my_buffer.insert(my_buffer.end(), pDirEnt->d_name, pDirEnt->d_name + info.nameLen + 1);
+                bytes += info.nameLen + 1;
+                batch.push_back(info);
+            }
+        }
+        if (bytes < DIR_BUFFER_SIZE)
+            my_is_more = false;
+        for (DirEntryInfo& info : batch)
+            info.name = my_buffer.data() + (size_t)info.name;
+#endif
     }
+    // No entries point into buffer once listing is done, held parents (-dirfd) keep none.
+    if (batch.empty())
+        std::vector<char>().swap(my_buffer);
+    return !batch.empty();
+}
+
+//-------------------------------------------------------------------------------------------------
+bool Directory_files::readBatch() {
+    my_batchIdx = 0;
+    if (! nextBatch(my_batch))
+        return false;
+    if (my_sortInode) {
+        std::sort(my_batch.begin(), my_batch.end(),
+            [](const DirEntryInfo& lhs, const DirEntryInfo& rhs) { return lhs.ino < rhs.ino; });
+    }
+    return true;
+}
 
-    return my_is_more;
+//-------------------------------------------------------------------------------------------------
+// Advance to next entry, thin wrapper over batch reader.
+bool Directory_files::more() {
+    if (++my_batchIdx < my_batch.size())
+        return true;
+    return readBatch();
 }
 
 //-------------------------------------------------------------------------------------------------
+// Some file systems (XFS, NFS, overlay) return DT_UNKNOWN, resolve with type only query.
 bool Directory_files::is_directory() const {
-    return my_pDirEnt->d_type == DT_DIR;
+    DirEntryInfo& entry = my_batch[my_batchIdx];
+    if (entry.type == DT_UNKNOWN) {
+        FileInfo info;
+        if (DirUtil::getInfoAt(info, dirFd(), entry.name, INFO_TYPE, my_statFlags | AT_SYMLINK_NOFOLLOW))
+            entry.type = IFTODT(info.mode);
+    }
+    return entry.type == DT_DIR;
 }
 
 //-------------------------------------------------------------------------------------------------
 const char* Directory_files::name() const {
-    return my_pDirEnt->d_name;
+    return my_batch[my_batchIdx].name;
 }
 
 //-------------------------------------------------------------------------------------------------
+// Base directory is clean (realpath or parent plus name), append only.
 const lstring& Directory_files::fullName(lstring& fname) const {
-    return DirUtil::join(fname, my_baseDir, my_pDirEnt->d_name);
+    fname.assign(my_baseDir);
+    return DirUtil::appendName(fname, my_batch[my_batchIdx].name);
+}
+
+//-------------------------------------------------------------------------------------------------
+bool Directory_files::getInfo(FileInfo& info, unsigned need) const {
+    return DirUtil::getInfoAt(info, dirFd(), my_batch[my_batchIdx].name, need, my_statFlags);
 }
 #endif
 
@@ -248,26 +440,36 @@ bool DirUtil::makeWriteableFile(const char* filePath, struct stat* info) {
 
 //-------------------------------------------------------------------------------------------------
 // [static] Extract directory part from path.
-lstring& DirUtil::getDir(lstring& outDir, const lstring& inPath) {
+std::string_view DirUtil::getDir(std::string_view inPath) {
     size_t nameStart = inPath.rfind(SLASH_CHAR);
-    if (nameStart == string::npos)
-        outDir.clear();
-    else
-        outDir = inPath.substr(0, nameStart);
+    return (nameStart == std::string_view::npos) ? std::string_view() : inPath.substr(0, nameStart);
+}
+lstring& DirUtil::getDir(lstring& outDir, std::string_view inPath) {
+    outDir = getDir(inPath);
     return outDir;
 }
 
 //-------------------------------------------------------------------------------------------------
 // Extract name part from path.
-lstring& DirUtil::getName(lstring& outName, const lstring& inPath) {
+std::string_view DirUtil::getName(std::string_view inPath) {
     size_t nameStart = inPath.rfind(SLASH_CHAR);
-    if (nameStart == std::string::npos)
-        outName = inPath;
-    else
-        outName = inPath.substr(nameStart + 1);
+    return (nameStart == std::string_view::npos) ? inPath : inPath.substr(nameStart + 1);
+}
+lstring& DirUtil::getName(lstring& outName, std::string_view inPath) {
+    outName = getName(inPath);      // inPath may view outName
     return outName;
 }
 
+//-------------------------------------------------------------------------------------------------
+// Clean root once, later appends never add double slashes.
+const lstring& PathBuilder::setRoot(const char* root) {
+    my_path = root;
+    size_t pos;
+    while ((pos = my_path.find(Directory_files::SLASH2)) != std::string::npos)
+        my_path.erase(pos, 1);
+    return my_path;
+}
+
 //-------------------------------------------------------------------------------------------------
 // Extract name part from path.
 lstring& DirUtil::removeExtn(lstring& outName, const lstring& inPath) {
@@ -362,9 +564,11 @@ bool getFileInfo(const char* filePath, size_t& id, size_t& nLinks) {
     return okay;
 }
 
-LinkStatus DirUtil::hardlink(bool dryRun, const char* masterPath, const char* linkPath) {
+LinkStatus DirUtil::hardlink(bool dryRun, const char* masterPath, const char* linkPath,
+        const FileInfo* masterInfo, const FileInfo* linkInfo) {
     LinkStatus status = dryRun ? DRYRUN : FAIL_LINK;
 
+    // Windows stat does not provide file id, always query by handle.
     size_t id1, id2;
     size_t links1, links2;
     bool statOk = getFileInfo(masterPath, id1, links1) && getFileInfo(linkPath, id2, links2);
@@ -410,14 +614,17 @@ LinkStatus DirUtil::hardlink(bool dryRun, const char* masterPath, const char* li
     return status;
 }
 #else
-LinkStatus DirUtil::hardlink(bool dryRun, const char* masterPath, const char* linkPath) {
+LinkStatus DirUtil::hardlink(bool dryRun, const char* masterPath, const char* linkPath,
+        const FileInfo* masterInfo, const FileInfo* linkInfo) {
     LinkStatus status = dryRun ? DRYRUN : FAIL_LINK;
     
-    struct stat infoMaster;
-    struct stat infoLink;
-    bool statOk = (stat(masterPath, &infoMaster) == 0) && (stat(linkPath, &infoLink) == 0);
+    FileInfo infoMaster;
+    FileInfo infoLink;
+    bool statOk = 
+        ((masterInfo != nullptr && masterInfo->has(INFO_ALL)) ? (infoMaster = *masterInfo, true) : getInfo(infoMaster, masterPath))
+        && ((linkInfo != nullptr && linkInfo->has(INFO_ALL)) ? (infoLink = *linkInfo, true) : getInfo(infoLink, linkPath));
             
-    if (statOk && infoMaster.st_ino == infoLink.st_ino) {
+    if (statOk && infoMaster.sameFile(infoLink)) {
         if (dryRun) {
             Colors::showError("Linked already: << ", masterPath, " ", linkPath);
             // std::cerr << "Linked already: << " << masterPath << " " << linkPath << std::endl;
@@ -432,19 +639,19 @@ LinkStatus DirUtil::hardlink(bool dryRun, const char* masterPath, const char* li
         if (::rename(linkPath, tmpName) == 0) {
             int statusCode = ::link(masterPath, linkPath);
             if (statusCode == 0) {
-                if (infoMaster.st_mode != infoLink.st_mode)
+                if (infoMaster.mode != infoLink.mode)
                     std::cerr << "Link caused permissions to changed from="
-                        << oct <<  infoLink.st_mode << " to " << oct << infoMaster.st_mode
+                        << oct <<  infoLink.mode << " to " << oct << infoMaster.mode
                         << " " << linkPath
                         << std::endl;
-                if (infoMaster.st_uid != infoLink.st_uid)
+                if (infoMaster.uid != infoLink.uid)
                     std::cerr << "Link caused user to change from="
-                        <<  infoLink.st_uid << " to " << infoMaster.st_uid
+                        <<  infoLink.uid << " to " << infoMaster.uid
                         << " " << linkPath
                         << std::endl;
-                if (infoMaster.st_gid != infoLink.st_gid)
+                if (infoMaster.gid != infoLink.gid)
                     std::cerr << "Link caused group to change from="
-                        <<  infoLink.st_uid << " to " << infoMaster.st_uid
+                        <<  infoLink.gid << " to " << infoMaster.gid
                         << " " << linkPath
                         << std::endl;
                 statusCode = ::unlink(tmpName);
@@ -501,6 +708,187 @@ size_t DirUtil::fileLength(const lstring& path) {
     return ( stat(path, &info) == 0 ) ? info.st_size : -1;
 }
 
+// ---------------------------------------------------------------------------
+void DirUtil::setInfo(FileInfo& outInfo, const struct stat& inStat) {
+    outInfo.have = INFO_ALL;
+    outInfo.size = inStat.st_size;
+    outInfo.dev = inStat.st_dev;
+    outInfo.ino = inStat.st_ino;
+    outInfo.nlink = inStat.st_nlink;
+    outInfo.mtime = inStat.st_mtime;
+    outInfo.mode = inStat.st_mode;
+    outInfo.uid = inStat.st_uid;
+    outInfo.gid = inStat.st_gid;
+}
+
+// ---------------------------------------------------------------------------
+bool DirUtil::getInfo(FileInfo& outInfo, const char* path) {
+    struct stat info;
+    if (stat(path, &info) != 0)
+        return false;
+    setInfo(outInfo, info);
+    return true;
+}
+
+#ifndef HAVE_WIN
+#ifdef HAVE_STATX
+// ---------------------------------------------------------------------------
+// Fields the file system returned (stx_mask), may be more or fewer than asked for.
+static void setInfo(FileInfo& outInfo, const struct statx& inStat) {
+    outInfo = FileInfo();       // listing entries are reused, drop previous file's fields
+    unsigned mask = inStat.stx_mask;
+    unsigned have = INFO_NONE;
+    outInfo.dev = makedev(inStat.stx_dev_major, inStat.stx_dev_minor);
+    if (mask & STATX_TYPE) {
+        outInfo.mode = inStat.stx_mode;
+        have |= INFO_TYPE;
+    }
+    if (mask & STATX_SIZE) {
+        outInfo.size = inStat.stx_size;
+        have |= INFO_SIZE;
+    }
+    if ((mask & (STATX_INO | STATX_NLINK)) == (STATX_INO | STATX_NLINK)) {
+        outInfo.ino = inStat.stx_ino;
+        outInfo.nlink = inStat.stx_nlink;
+        have |= INFO_ID;
+    }
+    if (mask & STATX_MTIME) {
+        outInfo.mtime = inStat.stx_mtime.tv_sec;
+        have |= INFO_TIME;
+    }
+    if ((mask & STATX_BASIC_STATS) == STATX_BASIC_STATS) {
+        outInfo.uid = inStat.stx_uid;
+        outInfo.gid = inStat.stx_gid;
+        have = INFO_ALL;
+    }
+    outInfo.have = have;
+}
+#endif
+
+// ---------------------------------------------------------------------------
+// Metadata of name relative to open directory handle.
+//   need    - InfoNeed bits, statx only asks file system for these fields.
+//   atFlags - AT_SYMLINK_NOFOLLOW, AT_STATX_DONT_SYNC
+bool DirUtil::getInfoAt(FileInfo& outInfo, int dirFd, const char* name, unsigned need, int atFlags) {
+#ifdef HAVE_STATX
+    unsigned mask = STATX_TYPE;
+    if (need & INFO_SIZE)
+        mask |= STATX_SIZE;
+    if (need & INFO_ID)
+        mask |= STATX_INO | STATX_NLINK;
+    if (need & INFO_TIME)
+        mask |= STATX_MTIME;
+    if (need == INFO_ALL)
+        mask = STATX_BASIC_STATS;
+
+    struct statx info;
+    if (statx(dirFd, name, atFlags, mask, &info) != 0)
+        return false;
+    setInfo(outInfo, info);
+#else
+    struct stat info;
+    if (fstatat(dirFd, name, &info, atFlags & AT_SYMLINK_NOFOLLOW) != 0)
+        return false;
+    setInfo(outInfo, info);
+#endif
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// True if fd is on NFS, SMB or other network file system where statx
+// should use cached attributes (AT_STATX_DONT_SYNC).
+bool DirUtil::isNetworkFs(int fd) {
+#ifdef HAVE_STATX
+    static const long NFS_MAGIC  = 0x6969;
+    static const long SMB_MAGIC  = 0x517B;
+    static const long SMB2_MAGIC = 0xFE534D42;
+    static const long CIFS_MAGIC = 0xFF534D42;
+    static const long CEPH_MAGIC = 0x00C36400;
+    static const long FUSE_MAGIC = 0x65735546;
+    struct statfs fsInfo;
+    if (fstatfs(fd, &fsInfo) != 0)
+        return false;
+    long fsType = (long)fsInfo.f_type;
+    return fsType == NFS_MAGIC || fsType == SMB_MAGIC || fsType == SMB2_MAGIC
+        || fsType == CIFS_MAGIC || fsType == CEPH_MAGIC || fsType == FUSE_MAGIC;
+#else
+    return false;
+#endif
+}
+#endif
+
+// ---------------------------------------------------------------------------
+// True if path is on a file system which shares extents between files
+// (reflink, dedup), only there sameExtents can succeed.
+bool DirUtil::canShareExtents(const char* path) {
+#ifdef HAVE_FIEMAP
+    static const long BTRFS_MAGIC    = 0x9123683E;
+    static const long XFS_MAGIC      = 0x58465342;
+    static const long BCACHEFS_MAGIC = 0xCA451A4E;
+    struct statfs fsInfo;
+    if (statfs(path, &fsInfo) != 0)
+        return false;
+    long fsType = (long)fsInfo.f_type;
+    return fsType == BTRFS_MAGIC || fsType == XFS_MAGIC || fsType == BCACHEFS_MAGIC;
+#else
+    return false;
+#endif
+}
+
+// ---------------------------------------------------------------------------
+// True if both files map to the same physical extents (reflink copy, dedup or
+// snapshot) so contents are identical without reading them. Extents the file
+// system can not place exactly (delayed, inline, encoded) are never trusted.
+bool DirUtil::sameExtents(const char* path1, const char* path2) {
+#ifdef HAVE_FIEMAP
+    static const unsigned BATCH = 64;       // extents per ioctl
+    static const unsigned UNSAFE = FIEMAP_EXTENT_UNKNOWN | FIEMAP_EXTENT_DELALLOC
+        | FIEMAP_EXTENT_ENCODED | FIEMAP_EXTENT_DATA_ENCRYPTED | FIEMAP_EXTENT_NOT_ALIGNED
+        | FIEMAP_EXTENT_DATA_INLINE | FIEMAP_EXTENT_DATA_TAIL | FIEMAP_EXTENT_UNWRITTEN;
+
+    int fd1 = open(path1, O_RDONLY | O_CLOEXEC);
+    int fd2 = open(path2, O_RDONLY | O_CLOEXEC);
+    const size_t mapWords = (sizeof(struct fiemap) + BATCH * sizeof(struct fiemap_extent)) / sizeof(uint64_t) + 1;
+    std::vector<uint64_t> buf1(mapWords), buf2(mapWords);
+    struct fiemap* map1 = (struct fiemap*)buf1.data();
+    struct fiemap* map2 = (struct fiemap*)buf2.data();
+
+    bool same = (fd1 != -1 && fd2 != -1);
+    bool last = false;
+    uint64_t start = 0;
+    while (same && !last) {
+        for (struct fiemap* map : { map1, map2 }) {
+            memset(map, 0, sizeof(struct fiemap));
+            map->fm_start = start;
+            map->fm_length = FIEMAP_MAX_OFFSET - start;
+            map->fm_flags = 0;                      // no sync, delayed extents fail UNSAFE
+            map->fm_extent_count = BATCH;
+        }
+        same = ioctl(fd1, FS_IOC_FIEMAP, map1) == 0 && ioctl(fd2, FS_IOC_FIEMAP, map2) == 0
+            && map1->fm_mapped_extents == map2->fm_mapped_extents && map1->fm_mapped_extents != 0;
+        for (unsigned idx = 0; same && idx < map1->fm_mapped_extents; idx++) {
+            const struct fiemap_extent& extent1 = map1->fm_extents[idx];
+            const struct fiemap_extent& extent2 = map2->fm_extents[idx];
+            same = extent1.fe_logical == extent2.fe_logical
+                && extent1.fe_physical == extent2.fe_physical
+                && extent1.fe_length == extent2.fe_length
+                && extent1.fe_flags == extent2.fe_flags
+                && (extent1.fe_flags & UNSAFE) == 0;
+            last = (extent1.fe_flags & FIEMAP_EXTENT_LAST) != 0;
+            start = extent1.fe_logical + extent1.fe_length;
+        }
+    }
+
+    if (fd1 != -1)
+        ::close(fd1);
+    if (fd2 != -1)
+        ::close(fd2);
+    return same;
+#else
+    return false;
+#endif
+}
+
 //-------------------------------------------------------------------------------------------------
 bool DirUtil::fileExists(const char* path) {
 #ifdef HAVE_WIN
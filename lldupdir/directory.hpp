@@ -45,6 +45,10 @@
 
 #include "ll_stdhdr.hpp"
 
+#include <vector>
+#include <stdint.h>
+#include <time.h>
+
 
 #ifdef HAVE_WIN
 #define byte win_byte_override  // Fix for c++ v17
@@ -86,12 +90,69 @@
     #include <sys/fcntl.h>
 #endif
 
+#if defined(__linux__)
+    #define HAVE_GETDENTS       // Bulk directory read using getdents64
+#endif
+
+// Metadata fields requested from, or captured by, file info queries.
+enum InfoNeed {
+    INFO_NONE = 0,
+    INFO_TYPE = 1,          // file type bits of mode
+    INFO_SIZE = 2,
+    INFO_ID   = 4,          // dev, ino and nlink
+    INFO_TIME = 8,          // mtime
+    INFO_ALL  = 0xff
+};
+
+// File metadata captured once during traversal and carried through to report.
+struct FileInfo {
+    uint64_t size  = 0;
+    uint64_t dev   = 0;
+    uint64_t ino   = 0;
+    unsigned nlink = 0;
+    time_t   mtime = 0;
+    unsigned mode  = 0;
+    unsigned uid   = 0;
+    unsigned gid   = 0;
+    unsigned have  = INFO_NONE;     // InfoNeed bits captured
+
+    bool has(unsigned need) const { return (have & need) == need && have != INFO_NONE; }
+    bool sameFile(const FileInfo& other) const {
+        return has(INFO_ID) && other.has(INFO_ID) && ino != 0 && ino == other.ino && dev == other.dev;
+    }
+};
+
+#ifndef HAVE_WIN
+    #if defined(__linux__) && defined(STATX_TYPE)
+        #define HAVE_STATX      // statx with minimal field masks
+    #endif
+    #if defined(__linux__)
+        #define HAVE_FIEMAP     // FS_IOC_FIEMAP extent maps
+    #endif
+    #ifndef AT_STATX_DONT_SYNC
+        #define AT_STATX_DONT_SYNC 0
+    #endif
+#endif
+
 class DirEntry;
 typedef void* HANDLE;
 
+#ifndef HAVE_WIN
+// Directory entry with type, inode and name length precomputed by batch reader.
+struct DirEntryInfo {
+    ino_t ino;
+    unsigned char type;     // DT_DIR, DT_REG, ... or DT_UNKNOWN
+    unsigned short nameLen;
+    const char* name;       // valid until next batch is read
+};
+typedef std::vector<DirEntryInfo> DirBatch;
+#endif
+
 class Directory_files {
 public:
     Directory_files(const lstring& dirName);
+    // Open sub directory relative to parent's open handle (openat), no realpath.
+    Directory_files(const Directory_files& parent, const char* subDirName);
     ~Directory_files();
 
     // Start at beginning of directory, return true if any files.
@@ -109,9 +170,24 @@ public:
     // Return directory path and entry name.
     const lstring& fullName(lstring& fname) const;
 
+    // Get metadata of current entry, relative to open directory handle if available.
+    //   need - InfoNeed bits, statx only requests these fields.
+    bool getInfo(FileInfo& info, unsigned need = INFO_ALL) const;
+
     // Close current directory
     void close();
 
+#ifndef HAVE_WIN
+    // Read next group of entries, skipping dot directories. Returns false at end.
+    bool nextBatch(DirBatch& batch);
+
+    // Open directory handle, -1 if closed.
+    int dirFd() const;
+
+    // Sort each batch by inode so stat and open walk the inode table in order.
+    void setSortInode(bool sortInode) { my_sortInode = sortInode; }
+#endif
+
     static const char SLASH_CHAR;   // '/'  linux, or '\\' windows (escaped slash)
     static const lstring SLASH;     // "/"  linux, or "\\" windows
     static const lstring SLASH2;    // "//" linux, or "\\\\" windows
@@ -126,11 +202,23 @@ private:
     lstring     my_dirName;     // Directory name
 #else
     bool        my_is_more;
+#ifdef HAVE_GETDENTS
+    int         my_dirFd;
+#else
     DIR*        my_pDir;
-    Dirent*     my_pDirEnt;         // Data structure describes the file found
+#endif
+    std::vector<char> my_buffer;    // getdents64 records or copied readdir names, freed at end
+#ifdef HAVE_GETDENTS
+    bool        my_bufferFull = false;  // last getdents64 filled over half, grow buffer
+#endif
+    mutable DirBatch my_batch;      // DT_UNKNOWN type resolved on demand
+    size_t      my_batchIdx;        // current entry in my_batch
+    int         my_statFlags;       // AT_STATX_DONT_SYNC on network file systems
+    bool        my_sortInode;       // sort batch by d_ino
     lstring     my_baseDir;
     char        my_fullname[PATH_MAX];
 
+    bool readBatch();
 #endif
 };
 
@@ -138,16 +226,29 @@ enum DIR_TYPES { IS_FILE, IS_DIR_BEG, IS_DIR_END };
 enum LinkStatus { DRYRUN, ALREADY, DONE, FAIL_BACKUP, FAIL_LINK, FAIL_RESTORE, FAIL_DEL_BACKUP };
 
 namespace DirUtil {
-    lstring& getDir(lstring& outName, const lstring& inPath);
-    lstring& getName(lstring& outName, const lstring& inPath);
+    lstring& getDir(lstring& outName, std::string_view inPath);
+    lstring& getName(lstring& outName, std::string_view inPath);
+    // Views into inPath, no copy.
+    std::string_view getDir(std::string_view inPath);
+    std::string_view getName(std::string_view inPath);
     lstring& getExt(lstring& outExt, const lstring& inPath);
     lstring& removeExtn(lstring& outName, const lstring& inPath);
     bool deleteFile(bool dryRun, const char* inPath);
     bool setPermission(const char* inPath, unsigned permission, bool setAllParts = false);
     size_t fileLength(const lstring& path);
+    bool getInfo(FileInfo& outInfo, const char* path);
+#ifndef HAVE_WIN
+    bool getInfoAt(FileInfo& outInfo, int dirFd, const char* name, unsigned need = INFO_ALL, int atFlags = 0);
+    bool isNetworkFs(int fd);
+#endif
+    bool canShareExtents(const char* path);
+    bool sameExtents(const char* path1, const char* path2);
+    void setInfo(FileInfo& outInfo, const struct stat& inStat);
     bool fileExists(const char* path);bool makeWriteableFile(const char* filePath, struct stat* info);
 
-    LinkStatus hardlink(bool dryRun, const char* masterPath, const char* linkPath);
+    // Optional master/link info avoids stat, pass nullptr to stat paths.
+    LinkStatus hardlink(bool dryRun, const char* masterPath, const char* linkPath,
+            const FileInfo* masterInfo = nullptr, const FileInfo* linkInfo = nullptr);
     void showLink(LinkStatus status, const char* masterPath, const char* linkPath);
     struct LinkCnts {
         unsigned int already;
@@ -175,4 +276,56 @@ namespace DirUtil {
     inline const lstring& join(lstring& outPath, lstring& inDir, const char* inName) {
          return ReplaceAll(( outPath = inDir + Directory_files::SLASH + inName ), Directory_files::SLASH2, Directory_files::SLASH);
     }
+
+    // Append name to clean path with exactly one slash between, no rescan of path.
+    inline lstring& appendName(lstring& path, const char* name) {
+        bool pathSlash = !path.empty() && path.back() == Directory_files::SLASH_CHAR;
+        if (name[0] == Directory_files::SLASH_CHAR)
+            name += pathSlash ? 1 : 0;
+        else if (! pathSlash)
+            path += Directory_files::SLASH_CHAR;
+        path += name;
+        return path;
+    }
 }
+
+// ---------------------------------------------------------------------------
+// Reusable path buffer. Root is cleaned once (double slashes removed), then
+// components are appended on descent and truncated on ascent.
+//
+//      PathBuilder path(baseDir);
+//      size_t mark = path.push(name);      // baseDir/name
+//      ...
+//      path.pop(mark);                     // baseDir
+class PathBuilder {
+public:
+    PathBuilder() {}
+    explicit PathBuilder(const char* root) {
+        setRoot(root);
+    }
+
+    const lstring& setRoot(const char* root);
+
+    // Append name, returns length to pop back to.
+    size_t push(const char* name) {
+        size_t mark = my_path.length();
+        DirUtil::appendName(my_path, name);
+        return mark;
+    }
+    void pop(size_t mark) {
+        my_path.resize(mark);
+    }
+
+    // Root joined with name into outPath, outPath keeps its capacity.
+    const lstring& join(lstring& outPath, const char* name) const {
+        outPath.assign(my_path);
+        return DirUtil::appendName(outPath, name);
+    }
+
+    const lstring& str() const {
+        return my_path;
+    }
+
+private:
+    lstring my_path;
+};
@@ -39,6 +39,7 @@
 
 #include <assert.h>
 #include <iostream>
+#include <algorithm>
 
 // ---------------------------------------------------------------------------
 template <class TT>
@@ -50,91 +51,199 @@ lstring& toString(lstring& buf, TT value) {
     return buf;
 }
 
-// ---------------------------------------------------------------------------
-static size_t fileLength(const lstring& path) {
-    struct stat info;
-    return (stat(path, &info) == 0) ? info.st_size : -1;
-}
-
 // ---------------------------------------------------------------------------
 DupScan::DupScan(Command& _command) : command(_command)  {
 }
 
 // ---------------------------------------------------------------------------
 bool DupScan::findDuplicates(unsigned level, const StringList& baseDirList, StringSet& subDirList) const {
-    scanFiles(level, baseDirList, subDirList);
-
     StringSet outDirList;
-    getDirs(level, baseDirList, subDirList, outDirList);
+    scanLevel(level, baseDirList, subDirList, outDirList);
     subDirList.swap(outDirList);
 
     return subDirList.size() > 0;
 }
 
 // ---------------------------------------------------------------------------
-void DupScan::done() {
+// Tail measured from end of walk in both dispatch orders.
+Hasher::TailStats DupScan::done() {
+    Hasher::TailStats stats;
     if (command.useThreads) {
-        Hasher::waitForAsync(command);
+        Hasher::beginTail();
+        dispatchJobs();
+        stats = Hasher::waitForAsync(command);
     }
+    return stats;
 }
 
 // ---------------------------------------------------------------------------
-void DupScan::scanFiles(unsigned level, const StringList& baseDirList, const StringSet& nextDirList) const {
-    StringSet files;
-    getFiles(level, baseDirList, nextDirList, files);
-    compareFiles(level, baseDirList, files);
+// Longest-processing-time first within the window, small files fill gaps.
+void DupScan::dispatchJobs() const {
+    std::stable_sort(hashJobs.begin(), hashJobs.end(),
+        [](const HashJob& lhs, const HashJob& rhs) { return lhs.size > rhs.size; });
+    for (const HashJob& job : hashJobs) {
+        if (Signals::aborted)
+            break;
+        Hasher::findDupsAsync(command, hashJobDirs, job.file);
+    }
+    hashJobs.clear();
 }
 
 // ---------------------------------------------------------------------------
-void DupScan::getFiles(unsigned level, const StringList& baseDirList, const StringSet& nextDirList, StringSet& outFiles) const {
-    lstring joinBuf;
+// Each directory of the level is read once under every root, files and
+// subdirectories together, subdirectories feed next level. Directories open
+// relative to the root handles.
+void DupScan::scanLevel(unsigned level, const StringList& baseDirList, const StringSet& nextDirList, StringSet& outDirList) const {
+    std::vector<Listing> listings(baseDirList.size());
+    DirHandles dirs;
+    StringSet dirNames;     // subdirectories of nextDir, all roots
+    outDirList.clear();
     for (const lstring& nextDir : nextDirList) {
-        for (const lstring& baseDir : baseDirList) {
-            Directory_files directory(DirUtil::join(joinBuf, baseDir, nextDir));
-
-            while (!Signals::aborted && directory.more()) {
-                if (! directory.is_directory()) {
-                    lstring name(directory.name());
-                    lstring fullname;
-                    directory.fullName(fullname);
-                    if (command.validFile(name, fullname)) {
-                        outFiles.insert(DirUtil::join(joinBuf, nextDir, name));
-                    }
-                }
-            }
-            if (Signals::aborted) {
-                outFiles.clear();
-                return;
-            }
+        if (! scanDir(level, baseDirList, rootDirs, nextDir, nextDir, dirs, listings, dirNames)) {
+            outDirList.clear();
+            return;
+        }
+        if (level == 0)
+            rootDirs = dirs;
+        PathBuilder relPath(nextDir);
+        for (const lstring& dirName : dirNames) {
+            size_t mark = relPath.push(dirName);
+            outDirList.push_back(relPath.str());
+            relPath.pop(mark);
         }
     }
+    // Children of sorted parents are not sorted ("a-b/x" before "a/x"), paths are unique.
+    std::sort(outDirList.begin(), outDirList.end());
 }
 
+// ---------------------------------------------------------------------------
+// Depth first, each directory's sorted subdirectory names wait on a stack
+// while the first subtree is compared. Memory is depth times fan-out.
+// Each frame holds its directory handles so children open by name (openat),
+// past MAX_HELD_DIRS handles children open relative to the roots.
+static const size_t MAX_HELD_DIRS = 256;
+unsigned DupScan::scanTree(const StringList& baseDirList) const {
+    struct Frame {
+        StringSet dirNames;     // sorted subdirectory names
+        size_t next;            // next dirNames entry to visit
+        size_t mark;            // relPath length before this directory
+        DirHandles dirs;        // open handles, empty when over MAX_HELD_DIRS
+    };
+    std::vector<Frame> stack(1);
+    std::vector<Listing> listings(baseDirList.size());
+    PathBuilder relPath("");
+    DirHandles dirs;
+    StringSet dirNames;
+    unsigned levels = 0;
+
+    stack.back().next = 0;
+    stack.back().mark = 0;
+    if (! scanDir(0, baseDirList, rootDirs, "", "", dirs, listings, stack.back().dirNames))
+        return levels;
+    rootDirs = dirs;
+    stack.back().dirs = dirs;
+    while (!Signals::aborted && ! stack.empty()) {
+        Frame& top = stack.back();
+        if (top.next == top.dirNames.size()) {
+            relPath.pop(top.mark);
+            stack.pop_back();
+            continue;
+        }
+        const lstring& dirName = top.dirNames[top.next++];
+        size_t mark = relPath.push(dirName);
+        bool held = ! top.dirs.empty();
+        if (! scanDir((unsigned)stack.size(), baseDirList, held ? top.dirs : rootDirs, held ? dirName : relPath.str(),
+                relPath.str(), dirs, listings, dirNames))
+            break;
+        unsigned level = (unsigned)stack.size();
+        levels = std::max(levels, level);
+        stack.emplace_back();       // invalidates top, dirName
+        stack.back().next = 0;
+        stack.back().mark = mark;
+        stack.back().dirNames.swap(dirNames);
+        if (stack.size() * baseDirList.size() <= MAX_HELD_DIRS)
+            stack.back().dirs.swap(dirs);
+    }
+    return levels;
+}
 
 // ---------------------------------------------------------------------------
-void DupScan::getDirs(unsigned level, const StringList& baseDirList, const StringSet& nextDirList, StringSet& outDirList) const {
-    lstring joinBuf;
-    for (const lstring& nextDir : nextDirList) {
-        for (const lstring& baseDir : baseDirList) {
-            Directory_files directory(DirUtil::join(joinBuf, baseDir, nextDir));
-            lstring fullname;
+// Open nextDir under every root, subPath relative to parents (empty at level 0,
+// roots opened by path), compare its files and return its subdirectory names
+// (sorted, unique) and handles. False if aborted.
+bool DupScan::scanDir(unsigned level, const StringList& baseDirList, const DirHandles& parents, const lstring& subPath,
+        const lstring& nextDir, DirHandles& dirs, std::vector<Listing>& listings, StringSet& dirNames) const {
+    dirNames.clear();
+    dirs.assign(baseDirList.size(), nullptr);
+    for (size_t baseIdx = 0; baseIdx < baseDirList.size(); baseIdx++) {
+        if (level == 0) {
+            // Directory_files falls back to the parent of a missing path, roots checked once.
+            FileInfo dirInfo;
+            if (DirUtil::getInfo(dirInfo, baseDirList[baseIdx]) && (dirInfo.mode & S_IFMT) == S_IFDIR)
+                dirs[baseIdx] = std::make_shared<Directory_files>(baseDirList[baseIdx]);
+            else
+                Colors::showError("Not a directory: ", baseDirList[baseIdx].c_str());
+        } else if (parents[baseIdx]) {
+            // Missing in this root, open fails and listing is empty.
+            const char* relName = subPath.c_str();
+            while (*relName == Directory_files::SLASH_CHAR)
+                relName++;      // relative paths are built with a leading slash
+            dirs[baseIdx] = std::make_shared<Directory_files>(*parents[baseIdx], relName);
+        }
+        listDir(dirs[baseIdx].get(), listings[baseIdx], dirNames);
+    }
+    if (Signals::aborted)
+        return false;
+    compareFiles(level, baseDirList, nextDir, listings);
 
-            if ( ! directory.begin() && level == 0) {
-                Colors::showError("Not a directory: ", baseDir.c_str());
-            }
-     
-            while (!Signals::aborted && directory.more()) {
-                directory.fullName(fullname);
-                if (directory.is_directory() && command.validFile(directory.name(), fullname)) {
-                    outDirList.insert(DirUtil::join(joinBuf, nextDir, directory.name()));
-                }
-            }
-            if (Signals::aborted) {
-                outDirList.clear();
-                return;
+    std::sort(dirNames.begin(), dirNames.end());
+    dirNames.erase(std::unique(dirNames.begin(), dirNames.end()), dirNames.end());
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// One read of an open directory. Files sorted by name with metadata from the
+// directory handle (statat), valid subdirectory names appended to dirNames.
+void DupScan::listDir(Directory_files* directory, Listing& listing, StringSet& dirNames) const {
+    lstring name, fullname;
+    bool needFullName = command.hasPathPatterns() || command.verbose;
+    unsigned infoNeed = command.infoNeed() | INFO_SIZE | INFO_ID;     // id finds shared copies
+    size_t count = 0;       // entries reused, keep their name capacity
+
+    while (directory != nullptr && !Signals::aborted && directory->more()) {
+        command.readCnt++;
+        name = directory->name();
+        if (needFullName)
+            directory->fullName(fullname);
+        if (directory->is_directory()) {
+            if (command.validDir(name, fullname))
+                dirNames.push_back(name);
+        } else if (command.validFile(name, fullname)) {
+            if (count == listing.size())
+                listing.emplace_back();
+            ListEntry& entry = listing[count];
+            if (directory->getInfo(entry.info, infoNeed)) {
+                entry.name = name;
+                count++;
             }
         }
     }
+    listing.resize(count);
+    std::sort(listing.begin(), listing.end(),
+        [](const ListEntry& lhs, const ListEntry& rhs) { return lhs.name < rhs.name; });
+}
+
+static const uint64_t MIN_EXTENT_CHECK = 64 * 1024;   // smaller files read, not mapped
+
+// -quick -sample, percent 0..100 from relative path (FNV-1a) so the same
+// files are picked on every run and for every root.
+static double samplePercent(const lstring& relPath) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (unsigned char chr : relPath) {
+        hash ^= chr;
+        hash *= 0x100000001b3ULL;
+    }
+    return (hash % 10000) / 100.0;
 }
 
 bool showIt = false;
@@ -149,74 +258,183 @@ void showValue(const lstring& path, const char* tag, TT value) {
 }
 
 // ---------------------------------------------------------------------------
-void DupScan::compareFiles(unsigned level, const StringList& baseDirList, const StringSet& files) const {
-    lstring joinBuf1, joinBuf2;
+// Merge-join of one directory's listings, name missing from a listing is missing
+// in that root, no stat of candidate paths. Every root is compared with the first
+// root, each copy is hashed at most once. With more than two roots each file
+// also gets a vote, how many roots hold identical copies.
+void DupScan::compareFiles(unsigned level, const StringList& baseDirList, const lstring& nextDir, const std::vector<Listing>& listings) const {
     showIt = command.verbose;   // hack
-    
-    for (const lstring& file : files) {
-        StringList::const_iterator dirIter = baseDirList.begin();
-        size_t fileLen1 = fileLength(DirUtil::join(joinBuf1, *dirIter++, file));
-        size_t fileLen2 = 0;
-        bool matchingLen = true;
+    const size_t roots = baseDirList.size();
 
-        showValue(joinBuf1, " len1=", fileLen1);
- 
-        while (!Signals::aborted && dirIter != baseDirList.end()) {
-            fileLen2 = fileLength(DirUtil::join(joinBuf2, *dirIter++, file));
-
-            showValue(joinBuf2, " len2=", fileLen2);
+    // Roots cleaned once, each path is root plus file.
+    std::vector<PathBuilder> basePaths(roots);
+    for (size_t baseIdx = 0; baseIdx < roots; baseIdx++)
+        basePaths[baseIdx].setRoot(baseDirList[baseIdx]);
+    PathBuilder relPath(nextDir);
+    if (rootExtents.size() != roots) {
+        rootExtents.resize(roots);
+        for (size_t baseIdx = 0; baseIdx < roots; baseIdx++)
+            rootExtents[baseIdx] = DirUtil::canShareExtents(baseDirList[baseIdx]);
+    }
 
-            if (command.justName) {
-                if (fileLen1 == fileLen2)
-                    command.showDuplicate(joinBuf1, joinBuf2);
-                else if (fileLen1 != -1 && fileLen2 != -1)
-                    command.showDifferent(joinBuf1, joinBuf2);
-                else
-                    command.showMissing((fileLen1 != -1), joinBuf1, (fileLen2 != -1), joinBuf2);
-            } else {
-                if (fileLen1 != fileLen2) {
-                    matchingLen = false;  // currently only two items in baseDirList, so no need to exit early
-                }
+    std::vector<size_t> cursors(roots, 0);
+    std::vector<const ListEntry*> entries(roots);   // per root, null if missing
+    lstring file;                                   // relative to roots
+    StringList paths(roots);                        // per root, reused
+    std::vector<bool> haves(roots);
+    std::vector<uint64_t> sizes(roots);
+    std::vector<uint64_t> hashes(roots);
+    std::vector<bool> shared(roots, false);         // identical to first root's copy
+    lstring absPath1, absPath2;
+    FileInfo noInfo;
+    while (!Signals::aborted) {
+        // Smallest name not yet visited, and the roots holding it.
+        const lstring* nextName = nullptr;
+        for (size_t baseIdx = 0; baseIdx < roots; baseIdx++) {
+            if (cursors[baseIdx] < listings[baseIdx].size()) {
+                const lstring& name = listings[baseIdx][cursors[baseIdx]].name;
+                if (nextName == nullptr || name < *nextName)
+                    nextName = &name;
             }
         }
+        if (nextName == nullptr)
+            break;
+        for (size_t baseIdx = 0; baseIdx < roots; baseIdx++) {
+            size_t& cursor = cursors[baseIdx];
+            bool have = cursor < listings[baseIdx].size() && listings[baseIdx][cursor].name == *nextName;
+            entries[baseIdx] = have ? &listings[baseIdx][cursor] : nullptr;
+        }
+        size_t mark = relPath.push(*nextName);
+        file = relPath.str();
+        relPath.pop(mark);
 
-        if (fileLen1 == -1 && fileLen2 == -1)
-            continue; // both file paths are missing
-        
-        if (command.justName)
+        bool filtered = command.hasPredicates();    // until one copy passes
+        bool matchingLen = true;
+        for (size_t baseIdx = 0; baseIdx < roots; baseIdx++) {
+            cursors[baseIdx] += (entries[baseIdx] != nullptr) ? 1 : 0;
+            basePaths[baseIdx].join(paths[baseIdx], file);
+            haves[baseIdx] = (entries[baseIdx] != nullptr);
+            sizes[baseIdx] = haves[baseIdx] ? entries[baseIdx]->info.size : 0;
+            hashes[baseIdx] = 0;
+            if (haves[baseIdx] && filtered && command.validInfo(entries[baseIdx]->info))
+                filtered = false;
+            if (!haves[baseIdx] || sizes[baseIdx] != sizes[0])
+                matchingLen = false;
+            showValue(paths[baseIdx], (baseIdx == 0) ? " len1=" : " len2=", haves[baseIdx] ? sizes[baseIdx] : size_t(-1));
+        }
+        if (filtered) {
+            command.filterCnt++;
             continue;
+        }
 
-        if (matchingLen) {
-            if (command.useThreads) {
-                Hasher::findDupsAsync(command, baseDirList, file);
-            } else {
-                dirIter = baseDirList.begin();
-                DirUtil::join(joinBuf1, *dirIter++, file);
-                joinBuf1 = command.absOrRel(joinBuf1);
-                HashValue hash1 = Hasher::compute(joinBuf1);  // hashValue = Md5::compute(joinBuf);
+        const FileInfo& info1 = haves[0] ? entries[0]->info : noInfo;
+        if (command.justName) {
+            for (size_t baseIdx = 1; baseIdx < roots; baseIdx++) {
+                const FileInfo& info2 = haves[baseIdx] ? entries[baseIdx]->info : noInfo;
+                if (haves[0] && haves[baseIdx] && sizes[0] == sizes[baseIdx])
+                    command.showDuplicate(paths[0], paths[baseIdx], &info1, &info2);
+                else if (haves[0] && haves[baseIdx])
+                    command.showDifferent(paths[0], paths[baseIdx]);
+                else if (haves[0] || haves[baseIdx])
+                    command.showMissing(haves[0], paths[0], haves[baseIdx], paths[baseIdx]);
+            }
+            continue;
+        }
 
-                showValue(joinBuf1, " hash1=", hash1);
+        // Quick, size and mtime decide unless file is sampled or an equal size
+        // copy has an mtime within skew of first root's copy.
+        bool verify = true;
+        if (command.quick) {
+            verify = command.quickSample > 0 && samplePercent(file) < command.quickSample;
+            for (size_t baseIdx = 1; baseIdx < roots && haves[0]; baseIdx++) {
+                if (haves[baseIdx] && sizes[baseIdx] == sizes[0]) {
+                    time_t mtime1 = entries[0]->info.mtime;
+                    time_t mtime2 = entries[baseIdx]->info.mtime;
+                    time_t skew = (mtime1 > mtime2) ? mtime1 - mtime2 : mtime2 - mtime1;
+                    verify = verify || (skew != 0 && skew <= command.quickSkew);
+                }
+            }
+            // Only count copies where size alone could not decide the outcome.
+            bool sameSizes = haves[0];
+            size_t copies = 0;
+            for (size_t baseIdx = 1; baseIdx < roots && sameSizes; baseIdx++) {
+                if (haves[baseIdx]) {
+                    copies++;
+                    sameSizes = (sizes[baseIdx] == sizes[0]);
+                }
+            }
+            if (sameSizes && copies != 0) {
+                if (verify)
+                    command.verifyCnt++;
+                else
+                    command.quickCnt++;
+            }
+        }
+
+        // Copies sharing first root's inode or physical extents are identical
+        // without reading. Small files are cheaper to read than to map.
+        bool anyShared = false;
+        for (size_t baseIdx = 1; baseIdx < roots; baseIdx++) {
+            shared[baseIdx] = verify && haves[0] && haves[baseIdx] && sizes[baseIdx] == sizes[0]
+                && (entries[0]->info.sameFile(entries[baseIdx]->info)
+                    || (sizes[0] >= MIN_EXTENT_CHECK && rootExtents[0] && rootExtents[baseIdx]
+                        && DirUtil::sameExtents(paths[0], paths[baseIdx])));
+            if (shared[baseIdx]) {
+                showValue(paths[baseIdx], " shared=", 1);
+                command.sharedCnt++;
+                anyShared = true;
+            }
+        }
 
-                while (!Signals::aborted && dirIter != baseDirList.end()) {
-                    DirUtil::join(joinBuf2, *dirIter++, file);
-                    joinBuf2 = command.absOrRel(joinBuf2);
-                    HashValue hash2 = Hasher::compute(joinBuf2); // hashValue = Md5::compute(joinBuf);
+        if (verify && !anyShared && matchingLen && command.useThreads && roots <= Hasher::MAX_ASYNC_ROOTS) {
+            if (command.largeFirst) {
+                if (hashJobDirs.empty())
+                    hashJobDirs = baseDirList;
+                hashJobs.push_back(HashJob{sizes[0], file});
+                if (hashJobs.size() >= MAX_HASH_WINDOW)
+                    dispatchJobs();
+            } else {
+                Hasher::findDupsAsync(command, baseDirList, file);
+            }
+            continue;
+        }
 
-                    showValue(joinBuf2, " hash2=", hash2);
+        // Hash each copy whose size matches another copy, once. Quick copies
+        // not verified compare mtime in place of hash, shared copies take
+        // first root's hash, which is only read if an unshared copy needs it.
+        for (size_t baseIdx = 0; baseIdx < roots && !Signals::aborted; baseIdx++) {
+            bool sizePair = false;
+            for (size_t other = 0; other < roots && !sizePair && haves[baseIdx]; other++)
+                sizePair = (other != baseIdx && haves[other] && sizes[other] == sizes[baseIdx]
+                    && !(baseIdx == 0 && shared[other]));
+            if (baseIdx != 0 && shared[baseIdx]) {
+                hashes[baseIdx] = hashes[0];
+            } else if (sizePair && !verify) {
+                hashes[baseIdx] = (uint64_t)entries[baseIdx]->info.mtime;
+            } else if (sizePair) {
+                hashes[baseIdx] = Hasher::compute(absPath1 = command.absOrRel(paths[baseIdx]));
+                showValue(absPath1, (baseIdx == 0) ? " hash1=" : " hash2=", hashes[baseIdx]);
+            }
+        }
+        if (Signals::aborted)
+            break;
 
-                    if (hash1 == hash2) {
-                        command.showDuplicate(joinBuf1, joinBuf2);
-                    } else {
-                        command.showDifferent(joinBuf1, joinBuf2);
-                    }
-                }
+        for (size_t baseIdx = 1; baseIdx < roots; baseIdx++) {
+            const FileInfo& info2 = haves[baseIdx] ? entries[baseIdx]->info : noInfo;
+            if (haves[0] && haves[baseIdx] && sizes[0] == sizes[baseIdx]) {
+                absPath1 = command.absOrRel(paths[0]);
+                absPath2 = command.absOrRel(paths[baseIdx]);
+                if (hashes[0] == hashes[baseIdx])
+                    command.showDuplicate(absPath1, absPath2, &info1, &info2);
+                else
+                    command.showDifferent(absPath1, absPath2);
+            } else if (haves[0] && haves[baseIdx]) {
+                command.showDifferent(paths[0], paths[baseIdx]);
+            } else if (haves[0] || haves[baseIdx]) {
+                command.showMissing(haves[0], paths[0], haves[baseIdx], paths[baseIdx]);
             }
-        } else {
-            if (fileLen1 != -1 && fileLen2 != -1)
-                command.showDifferent(joinBuf1, joinBuf2);
-            else
-                command.showMissing((fileLen1 != -1), joinBuf1, (fileLen2 != -1), joinBuf2);
         }
+        if (roots > 2)
+            command.showVote(paths, haves, sizes, hashes);
     }
 }
-
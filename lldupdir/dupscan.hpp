@@ -7,8 +7,7 @@
 //
 //      The normal usage will be something like this:
 //         DupScan dupScan;
-//         StringSet nextDirList;
-//         nextDirList.insert("");
+//         StringSet nextDirList(1, "");
 //         unsigned level = 0;
 //         while (dupScan.findDuplicates(level, fileDirList, nextDirList, *commandPtr)) {
 //             level++;
@@ -46,9 +45,11 @@
 
 #include "ll_stdhdr.hpp"
 #include "command.hpp"
+#include "hasher.hpp"     // Hasher::TailStats
 
-#include <set>
-typedef set<lstring> StringSet;
+#include <vector>
+#include <memory>
+typedef std::vector<lstring> StringSet;     // sorted, no duplicates
 
 class DupScan {
 public:
@@ -58,21 +59,56 @@ public:
 
     // Find duplicate files by name, size and hash_value
     //    Level used for diagnostics only.
-    //    baseDirList contains 2 root directories to compare files by name, size and content.
+    //    baseDirList contains 2 or more root directories to compare files by name, size and content,
+    //      each root compared with the first.
     //    subDirList contains subdirectory paths to append to root, can be single emptry string.
     //    subDirList is replace with new set of directories for each depth level scanned.
     //    command - currently not used
     //
     //    returns - false when no more directories available.
     bool findDuplicates(unsigned level, const StringList& baseDirList, StringSet& subDirList) const;
-    void done();
+
+    // Same compare depth first (-dfs), subtrees in sorted order, memory bounded
+    // by tree depth times directory fan-out instead of level width.
+    //    returns - deepest level scanned.
+    unsigned scanTree(const StringList& baseDirList) const;
+    Hasher::TailStats done();
 
 private:
-    void scanFiles(unsigned level, const StringList& baseDirList, const StringSet& nextDirList) const;
-    void getFiles(unsigned level, const StringList& baseDirList, const StringSet& nextDirList, set<lstring>& files) const;
-    void getDirs(unsigned level, const StringList& baseDirList, const StringSet& nextDirList, StringSet& outDirList) const;
-    void compareFiles(unsigned level, const StringList& baseDirList, const set<lstring>& files) const;
+    // One file of one root's directory, metadata from statat on the open
+    // directory handle while listing (directories themselves are not stat'ed).
+    struct ListEntry {
+        lstring name;
+        FileInfo info;
+    };
+    typedef std::vector<ListEntry> Listing;     // sorted by name
+
+    // Open directory per root, null where the directory is missing in that root.
+    typedef std::vector<std::shared_ptr<Directory_files>> DirHandles;
+
+    void scanLevel(unsigned level, const StringList& baseDirList, const StringSet& nextDirList, StringSet& outDirList) const;
+    bool scanDir(unsigned level, const StringList& baseDirList, const DirHandles& parents, const lstring& subPath,
+            const lstring& nextDir, DirHandles& dirs, std::vector<Listing>& listings, StringSet& dirNames) const;
+    void listDir(Directory_files* directory, Listing& listing, StringSet& dirNames) const;
+    void compareFiles(unsigned level, const StringList& baseDirList, const lstring& nextDir, const std::vector<Listing>& listings) const;
+
+    // -largeFirst, hash jobs held back in a window of MAX_HASH_WINDOW jobs,
+    // each full window dispatched largest first while the walk continues.
+    static constexpr size_t MAX_HASH_WINDOW = 256;
+    struct HashJob {
+        size_t size;
+        lstring file;
+    };
+    mutable std::vector<HashJob> hashJobs;
+    mutable StringList hashJobDirs;
+    void dispatchJobs() const;
+
+    // Per root, file system can share extents (btrfs, xfs), checked once.
+    mutable std::vector<bool> rootExtents;
 
+    // Roots opened once (level 0), deeper directories open relative to them or
+    // to their parent (-dfs), no realpath or stat per directory.
+    mutable DirHandles rootDirs;
 
 };
 
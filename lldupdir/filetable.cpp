@@ -0,0 +1,278 @@
+//-------------------------------------------------------------------------------------------------
+//
+// File: filetable.cpp   Author: Dennis Lang  Desc: Compact table of scanned files.
+//
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2024
+// https://landenlabs.com
+//
+//
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "ll_stdhdr.hpp"
+#include "filetable.hpp"
+
+#include <assert.h>
+#include <algorithm>
+#include <string.h>
+
+// ---------------------------------------------------------------------------
+void StringPool::clear(size_t _blockSize) {
+    blocks.clear();
+    blockSize = std::min(std::max(_blockSize, MIN_BLOCK_SIZE), MAX_BLOCK_SIZE);
+    used = blockSize;
+}
+
+// ---------------------------------------------------------------------------
+StringPool::Ref StringPool::add(const char* str, size_t len) {
+    assert(len < blockSize);
+    if (used + len + 1 > blockSize) {
+        blocks.emplace_back(new char[blockSize]);
+        used = 0;
+    }
+    Ref ref = ((Ref)(blocks.size() - 1) << BLOCK_BITS) + used;
+    char* dst = blocks.back().get() + used;
+    memcpy(dst, str, len);
+    dst[len] = '\0';
+    used += len + 1;
+    return ref;
+}
+
+// ---------------------------------------------------------------------------
+void FileTable::clear(bool _keepFullInfo, size_t poolBlockSize) {
+    keepFullInfo = _keepFullInfo;
+    pool.clear(poolBlockSize);
+    dirParents.assign(1, 0);
+    dirNames.assign(1, pool.add("", 0));
+    lastDir.clear();
+    lastDirIds.clear();
+    lastDirEnds.clear();
+
+    dirIds.clear();
+    nameRefs.clear();
+    sizes.clear();
+    devs.clear();
+    inos.clear();
+    hashes.clear();
+    haves.clear();
+    fullInfos.clear();
+}
+
+// ---------------------------------------------------------------------------
+// Directory node for fullname[0..nameOff), scan delivers files directory by
+// directory so only components which differ from previous directory are added.
+FileTable::DirId FileTable::addDir(const lstring& fullname, size_t nameOff) {
+    // Keep components shared with previous directory.
+    size_t keep = 0;
+    while (keep < lastDirEnds.size() && lastDirEnds[keep] <= nameOff
+            && fullname.compare(0, lastDirEnds[keep], lastDir, 0, lastDirEnds[keep]) == 0)
+        keep++;
+    lastDirIds.resize(keep);
+    lastDirEnds.resize(keep);
+    lastDir.assign(fullname, 0, nameOff);
+
+    size_t pos = (keep == 0) ? 0 : lastDirEnds.back();
+    while (pos < nameOff) {
+        size_t end = lastDir.find(Directory_files::SLASH_CHAR, pos);
+        end = (end == std::string::npos) ? nameOff : end + 1;
+        DirId parent = lastDirIds.empty() ? 0 : lastDirIds.back();
+        lastDirIds.push_back((DirId)dirParents.size());
+        lastDirEnds.push_back(end);
+        dirParents.push_back(parent);
+        size_t len = end - pos - ((lastDir[end - 1] == Directory_files::SLASH_CHAR) ? 1 : 0);
+        dirNames.push_back(pool.add(lastDir.c_str() + pos, len));
+        pos = end;
+    }
+    return lastDirIds.empty() ? 0 : lastDirIds.back();
+}
+
+// ---------------------------------------------------------------------------
+void FileTable::add(const lstring& fullname, size_t nameOff, const FileInfo& info) {
+    DirId dirId = (lastDir.length() == nameOff && fullname.compare(0, nameOff, lastDir) == 0 && !lastDirIds.empty())
+        ? lastDirIds.back() : addDir(fullname, nameOff);
+
+    dirIds.push_back(dirId);
+    nameRefs.push_back(pool.add(fullname.c_str() + nameOff, fullname.length() - nameOff));
+    sizes.push_back(info.size);
+    devs.push_back(info.dev);
+    inos.push_back(info.ino);
+    hashes.push_back(0);
+    haves.push_back((uint8_t)info.have);
+    if (keepFullInfo)
+        fullInfos.push_back(info);
+}
+
+// ---------------------------------------------------------------------------
+void FileTable::appendDir(lstring& outPath, DirId dirId) const {
+    if (dirId != 0) {
+        appendDir(outPath, dirParents[dirId]);
+        outPath += pool.get(dirNames[dirId]);
+        outPath += Directory_files::SLASH_CHAR;
+    }
+}
+
+// ---------------------------------------------------------------------------
+lstring& FileTable::dir(lstring& outDir, FileIdx idx) const {
+    outDir.clear();
+    appendDir(outDir, dirIds[idx]);
+    return outDir;
+}
+
+// ---------------------------------------------------------------------------
+lstring& FileTable::path(lstring& outPath, FileIdx idx) const {
+    dir(outPath, idx);
+    outPath += name(idx);
+    return outPath;
+}
+
+// ---------------------------------------------------------------------------
+// Same directory path, nodes differ when a directory is reached twice (overlapping roots).
+bool FileTable::sameDir(DirId dirId1, DirId dirId2) const {
+    while (dirId1 != dirId2) {
+        if (dirId1 == 0 || dirId2 == 0 || strcmp(pool.get(dirNames[dirId1]), pool.get(dirNames[dirId2])) != 0)
+            return false;
+        dirId1 = dirParents[dirId1];
+        dirId2 = dirParents[dirId2];
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+bool FileTable::samePath(FileIdx idx1, FileIdx idx2) const {
+    return strcmp(name(idx1), name(idx2)) == 0 && sameDir(dirIds[idx1], dirIds[idx2]);
+}
+
+// ---------------------------------------------------------------------------
+FileInfo& FileTable::info(FileInfo& outInfo, FileIdx idx) const {
+    if (keepFullInfo) {
+        outInfo = fullInfos[idx];
+    } else {
+        outInfo = FileInfo();
+        outInfo.size = sizes[idx];
+        outInfo.dev = devs[idx];
+        outInfo.ino = inos[idx];
+        outInfo.have = haves[idx] & (INFO_SIZE | INFO_ID);
+    }
+    return outInfo;
+}
+
+// ---------------------------------------------------------------------------
+void FileTable::sortByName(FileIdxList& order) const {
+    order.resize(size());
+    for (size_t idx = 0; idx < order.size(); idx++)
+        order[idx] = (FileIdx)idx;
+    std::stable_sort(order.begin(), order.end(), [this](FileIdx lhs, FileIdx rhs) {
+        return strcmp(name(lhs), name(rhs)) < 0;
+    });
+}
+
+// ---------------------------------------------------------------------------
+size_t FileTable::memoryUsed() const {
+    return pool.bytes()
+        + dirParents.capacity() * sizeof(DirId)
+        + dirNames.capacity() * sizeof(StringPool::Ref)
+        + dirIds.capacity() * sizeof(DirId)
+        + nameRefs.capacity() * sizeof(StringPool::Ref)
+        + (sizes.capacity() + devs.capacity() + inos.capacity() + hashes.capacity()) * sizeof(uint64_t)
+        + haves.capacity()
+        + fullInfos.capacity() * sizeof(FileInfo);
+}
+
+// ---------------------------------------------------------------------------
+static size_t nextPow2(size_t value) {
+    size_t pow2 = 1;
+    while (pow2 < value)
+        pow2 <<= 1;
+    return pow2;
+}
+
+// ---------------------------------------------------------------------------
+// Two passes, assign group per item then scatter items by group (counting sort).
+void FileGroups::build(const uint64_t* keys, const FileIdx* files, size_t count) {
+    // Groups never outnumber items, 2 * count slots keep load factor at most 1/2.
+    size_t capacity = nextPow2(std::max(count * 2, (size_t)2));
+    size_t mask = capacity - 1;
+    slotKeys.assign(capacity, 0);
+    slotGroups.assign(capacity, uint32_t(EMPTY));
+    groupKeys.clear();
+    groupKeys.reserve(count);
+    itemGroups.resize(count);
+    starts.clear();
+    starts.reserve(count + 1);
+
+    for (size_t item = 0; item < count; item++) {
+        size_t slot = slotOf(keys[item], mask);
+        while (slotGroups[slot] != EMPTY && slotKeys[slot] != keys[item])
+            slot = (slot + 1) & mask;
+        if (slotGroups[slot] == EMPTY) {
+            slotKeys[slot] = keys[item];
+            slotGroups[slot] = (uint32_t)groupKeys.size();
+            groupKeys.push_back(keys[item]);
+            starts.push_back(0);
+        }
+        itemGroups[item] = slotGroups[slot];
+        starts[itemGroups[item]]++;
+    }
+
+    // Counts to offsets.
+    size_t offset = 0;
+    for (size_t& start : starts) {
+        size_t groupCount = start;
+        start = offset;
+        offset += groupCount;
+    }
+    starts.push_back(offset);
+
+    members.resize(count);
+    for (size_t item = 0; item < count; item++)
+        members[starts[itemGroups[item]]++] = files[item];
+
+    // Scatter advanced each start to next group's start, shift back.
+    for (size_t group = groupKeys.size(); group > 0; group--)
+        starts[group] = starts[group - 1];
+    starts[0] = 0;
+}
+
+// ---------------------------------------------------------------------------
+size_t FileGroups::find(uint64_t key) const {
+    size_t mask = slotKeys.size() - 1;
+    size_t slot = slotOf(key, mask);
+    while (slotGroups[slot] != EMPTY) {
+        if (slotKeys[slot] == key)
+            return slotGroups[slot];
+        slot = (slot + 1) & mask;
+    }
+    return NONE;
+}
+
+// ---------------------------------------------------------------------------
+void FileGroups::sortByKey(std::vector<size_t>& order) const {
+    order.resize(size());
+    for (size_t group = 0; group < order.size(); group++)
+        order[group] = group;
+    std::sort(order.begin(), order.end(), [this](size_t lhs, size_t rhs) {
+        return groupKeys[lhs] < groupKeys[rhs];
+    });
+}
+
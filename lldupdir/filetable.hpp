@@ -0,0 +1,225 @@
+//-------------------------------------------------------------------------------------------------
+// File: filetable.hpp
+// Author: Dennis Lang
+//
+// Desc: Compact table of files found during scan, one entry per file stored
+//       as parallel arrays (struct of arrays) with names kept in a string arena.
+//
+// Usage::
+//      Files are appended during the scan and referenced by index afterwards,
+//      grouping sorts or buckets indices instead of building node based maps.
+//
+//          FileTable fileTable;
+//          fileTable.add(fullname, nameOff, info);
+//          ...
+//          FileIdxList order;
+//          fileTable.sortByName(order);
+//          fileTable.path(fullPath, order[0]);
+//
+//      Directories are interned as a tree of (parent, name) nodes so shared
+//      path prefixes are stored once, full paths are rebuilt only for output.
+//
+//      FileGroups buckets file indices by a 64 bit key (size or hash value)
+//      with a flat open addressing table instead of a map of vectors.
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2024
+// https://landenlabs.com
+//
+//
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#include "ll_stdhdr.hpp"
+#include "lstring.hpp"
+#include "directory.hpp"    // FileInfo
+
+#include <vector>
+#include <memory>
+#include <stdint.h>
+
+typedef uint32_t FileIdx;
+typedef std::vector<FileIdx> FileIdxList;
+
+// ---------------------------------------------------------------------------
+// Append only string arena, strings never move and are referenced by position.
+class StringPool {
+public:
+    typedef uint64_t Ref;
+
+    static constexpr size_t MIN_BLOCK_SIZE = 4096;
+    static constexpr unsigned BLOCK_BITS = 20;  // 1 MB blocks at most
+    static constexpr size_t MAX_BLOCK_SIZE = size_t(1) << BLOCK_BITS;
+
+    // Empty pool, new blocks hold blockSize bytes (clamped to MIN..MAX_BLOCK_SIZE).
+    void clear(size_t blockSize = MAX_BLOCK_SIZE);
+
+    // Store string and terminating nul, length must be less than block size.
+    Ref add(const char* str, size_t len);
+
+    const char* get(Ref ref) const {
+        return blocks[ref >> BLOCK_BITS].get() + (ref & BLOCK_MASK);
+    }
+
+    size_t bytes() const {
+        return blocks.size() * blockSize;
+    }
+
+private:
+    static constexpr size_t BLOCK_MASK = MAX_BLOCK_SIZE - 1;
+
+    std::vector<std::unique_ptr<char[]>> blocks;
+    size_t blockSize = MAX_BLOCK_SIZE;
+    size_t used = MAX_BLOCK_SIZE;               // bytes used in last block
+};
+
+// ---------------------------------------------------------------------------
+class FileTable {
+public:
+    typedef uint32_t DirId;
+
+    // Empty table, keepFullInfo stores complete FileInfo (verbose, hardlink),
+    // name pool grows by poolBlockSize, smaller blocks for a small -maxMem.
+    void clear(bool keepFullInfo, size_t poolBlockSize = StringPool::MAX_BLOCK_SIZE);
+
+    // Add file, fullname is split at nameOff into directory and name.
+    void add(const lstring& fullname, size_t nameOff, const FileInfo& info);
+
+    size_t size() const {
+        return dirIds.size();
+    }
+
+    const char* name(FileIdx idx) const {
+        return pool.get(nameRefs[idx]);
+    }
+
+    // Directory path including trailing slash, rebuilt from directory tree.
+    lstring& dir(lstring& outDir, FileIdx idx) const;
+    lstring& path(lstring& outPath, FileIdx idx) const;
+    bool samePath(FileIdx idx1, FileIdx idx2) const;
+
+    uint64_t fileSize(FileIdx idx) const {
+        return sizes[idx];
+    }
+    uint64_t ino(FileIdx idx) const {
+        return inos[idx];
+    }
+    uint64_t dev(FileIdx idx) const {
+        return devs[idx];
+    }
+    bool has(FileIdx idx, unsigned need) const {
+        return (haves[idx] & need) == need && haves[idx] != INFO_NONE;
+    }
+
+    // Metadata captured during scan, only size and id unless keepFullInfo.
+    FileInfo& info(FileInfo& outInfo, FileIdx idx) const;
+
+    uint64_t hash(FileIdx idx) const {
+        return hashes[idx];
+    }
+    void setHash(FileIdx idx, uint64_t hashValue) {
+        hashes[idx] = hashValue;
+    }
+
+    // All file indices ordered by name, equal names keep scan order.
+    void sortByName(FileIdxList& order) const;
+
+    // Approximate bytes held by table.
+    size_t memoryUsed() const;
+
+private:
+    StringPool pool;
+
+    // Directory tree, parent id and name component per directory,
+    // node 0 is the empty root above the first path component.
+    std::vector<DirId> dirParents;
+    std::vector<StringPool::Ref> dirNames;
+    lstring lastDir;                    // directory of previous add
+    std::vector<DirId> lastDirIds;      // node per component of lastDir
+    std::vector<size_t> lastDirEnds;    // end of each component in lastDir
+
+    DirId addDir(const lstring& fullname, size_t nameOff);
+    void appendDir(lstring& outPath, DirId dirId) const;
+    bool sameDir(DirId dirId1, DirId dirId2) const;
+
+    // File columns, one entry per file.
+    std::vector<DirId> dirIds;
+    std::vector<StringPool::Ref> nameRefs;
+    std::vector<uint64_t> sizes;
+    std::vector<uint64_t> devs;
+    std::vector<uint64_t> inos;
+    std::vector<uint64_t> hashes;
+    std::vector<uint8_t> haves;         // InfoNeed bits captured
+    std::vector<FileInfo> fullInfos;    // only when keepFullInfo
+    bool keepFullInfo = false;
+};
+
+// ---------------------------------------------------------------------------
+// Group file indices by 64 bit key. Flat open addressing table (linear probe)
+// plus one members array, no allocation per group. Members keep input order,
+// groups are numbered in order of first appearance.
+class FileGroups {
+public:
+    static const size_t NONE = size_t(-1);
+
+    // Group files[i] by keys[i], replaces any previous content.
+    void build(const uint64_t* keys, const FileIdx* files, size_t count);
+
+    size_t size() const {
+        return groupKeys.size();
+    }
+    uint64_t key(size_t group) const {
+        return groupKeys[group];
+    }
+    size_t count(size_t group) const {
+        return starts[group + 1] - starts[group];
+    }
+    const FileIdx* files(size_t group) const {
+        return members.data() + starts[group];
+    }
+
+    // Group holding key or NONE.
+    size_t find(uint64_t key) const;
+
+    // Group numbers ordered by key.
+    void sortByKey(std::vector<size_t>& order) const;
+
+private:
+    static const uint32_t EMPTY = uint32_t(-1);
+
+    std::vector<uint64_t> slotKeys;
+    std::vector<uint32_t> slotGroups;       // EMPTY or group number
+    std::vector<uint64_t> groupKeys;
+    std::vector<size_t> starts;             // members offset per group, size()+1 entries
+    std::vector<FileIdx> members;
+    std::vector<uint32_t> itemGroups;       // group per input item
+
+    static size_t slotOf(uint64_t key, size_t mask) {
+        key ^= key >> 33;                   // murmur3 finalizer, spreads small sizes
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        return (size_t)key & mask;
+    }
+};
+
@@ -0,0 +1,120 @@
+//-------------------------------------------------------------------------------------------------
+//
+// File: groupsort.cpp   Author: Dennis Lang  Desc: Parallel radix sort of group tuples.
+//
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2024
+// https://landenlabs.com
+//
+//
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "ll_stdhdr.hpp"
+#include "groupsort.hpp"
+
+#include <thread>
+#include <algorithm>
+
+static const unsigned DIGIT_BITS = 8;
+static const size_t DIGITS = size_t(1) << DIGIT_BITS;
+static const size_t MIN_PARALLEL = 1 << 16;    // smaller arrays sort in one thread
+
+// ---------------------------------------------------------------------------
+unsigned GroupSort::threadCount(unsigned maxThreads) {
+    unsigned threads = std::thread::hardware_concurrency();
+    return std::max(1u, std::min(threads, maxThreads));
+}
+
+// ---------------------------------------------------------------------------
+void GroupSort::parallel(unsigned threads, const std::function<void(unsigned)>& func) {
+    std::vector<std::thread> workers;
+    for (unsigned thread = 1; thread < threads; thread++)
+        workers.emplace_back(func, thread);
+    func(0);
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+// ---------------------------------------------------------------------------
+// One stable counting pass on 8 bits of field. Each thread counts and scatters
+// its own slice, slices are ordered so the pass stays stable.
+// Returns false, without moving anything, when every key has the same digit.
+static bool radixPass(const GroupTuples& src, GroupTuples& dst,
+        uint64_t GroupTuple::* field, unsigned shift, unsigned threads) {
+    size_t count = src.size();
+    if (count < MIN_PARALLEL)
+        threads = 1;
+    size_t slice = (count + threads - 1) / threads;
+    std::vector<size_t> offsets(threads * DIGITS, 0);    // [thread][digit]
+
+    GroupSort::parallel(threads, [&](unsigned thread) {
+        size_t* counts = &offsets[thread * DIGITS];
+        size_t end = std::min(count, (thread + 1) * slice);
+        for (size_t pos = thread * slice; pos < end; pos++)
+            counts[(src[pos].*field >> shift) & (DIGITS - 1)]++;
+    });
+
+    size_t total = 0;
+    for (size_t digit = 0; digit < DIGITS; digit++) {
+        size_t digitCnt = 0;
+        for (unsigned thread = 0; thread < threads; thread++) {
+            size_t threadCnt = offsets[thread * DIGITS + digit];
+            offsets[thread * DIGITS + digit] = total + digitCnt;
+            digitCnt += threadCnt;
+        }
+        if (digitCnt == count)
+            return false;
+        total += digitCnt;
+    }
+
+    GroupSort::parallel(threads, [&](unsigned thread) {
+        size_t* next = &offsets[thread * DIGITS];
+        size_t end = std::min(count, (thread + 1) * slice);
+        for (size_t pos = thread * slice; pos < end; pos++)
+            dst[next[(src[pos].*field >> shift) & (DIGITS - 1)]++] = src[pos];
+    });
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+static void radixSort(GroupTuples& tuples, GroupTuples& scratch,
+        uint64_t GroupTuple::* field, unsigned threads) {
+    scratch.resize(tuples.size());
+    for (unsigned shift = 0; shift < 64; shift += DIGIT_BITS) {
+        if (radixPass(tuples, scratch, field, shift, threads))
+            tuples.swap(scratch);
+    }
+}
+
+// ---------------------------------------------------------------------------
+void GroupSort::sortBySize(GroupTuples& tuples, GroupTuples& scratch, unsigned threads) {
+    radixSort(tuples, scratch, &GroupTuple::size, threads);
+}
+
+// ---------------------------------------------------------------------------
+// LSD, minor key first.
+void GroupSort::sortBySizeHash(GroupTuples& tuples, GroupTuples& scratch, unsigned threads) {
+    radixSort(tuples, scratch, &GroupTuple::hash, threads);
+    radixSort(tuples, scratch, &GroupTuple::size, threads);
+}
@@ -0,0 +1,75 @@
+//-------------------------------------------------------------------------------------------------
+// File: groupsort.hpp
+// Author: Dennis Lang
+//
+// Desc: Parallel LSD radix sort of (size, hash, file) tuples, used to group
+//       duplicate candidates by sorting one flat array and sweeping runs.
+//
+// Usage::
+//          GroupTuples tuples, scratch;
+//          ...
+//          GroupSort::sortBySize(tuples, scratch, threads);
+//          // sweep equal size runs, hash survivors into tuple.hash
+//          GroupSort::sortBySizeHash(tuples, scratch, threads);
+//          // sweep equal (size, hash) runs
+//
+//      Sorts are stable, equal keys keep input order. Memory is the tuple
+//      array plus one scratch array of the same size.
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2024
+// https://landenlabs.com
+//
+//
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#include "ll_stdhdr.hpp"
+#include "filetable.hpp"    // FileIdx
+
+#include <vector>
+#include <functional>
+#include <stdint.h>
+
+// 24 byte sort record.
+struct GroupTuple {
+    uint64_t size;
+    uint64_t hash;
+    FileIdx fileIdx;
+};
+typedef std::vector<GroupTuple> GroupTuples;
+
+namespace GroupSort {
+    // Worker threads to use, hardware threads capped at maxThreads.
+    unsigned threadCount(unsigned maxThreads);
+
+    // Run func(thread) on threads, thread 0 in caller.
+    void parallel(unsigned threads, const std::function<void(unsigned)>& func);
+
+    // Stable sort by size.
+    void sortBySize(GroupTuples& tuples, GroupTuples& scratch, unsigned threads);
+
+    // Stable sort by (size, hash).
+    void sortBySizeHash(GroupTuples& tuples, GroupTuples& scratch, unsigned threads);
+}
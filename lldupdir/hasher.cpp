@@ -56,15 +56,24 @@ std::atomic<ThreadCnt> threadCnt(0);
 const ThreadCnt MAX_THREADS = 8;
 std::shared_timed_mutex  lock1;   // locked while thread count is increasing
 
+// Tail statistics, time threads are idle after the walk ends (beginTail).
+typedef std::chrono::steady_clock Clock;
+static Clock::time_point tailStartT = Clock::time_point::max();  // set by beginTail
+static Clock::time_point tailEndT;          // time last job finished
+static double tailBusySec = 0;              // thread seconds busy after tailStartT
+
 // -----
 class ThreadJob  {
 public:
     lstring path;
     HashValue hashValue;
     volatile bool isDone;
+    Clock::time_point startT;
+    Clock::time_point doneT;
     std::thread thread1;
 
     ThreadJob(const lstring& _path): path(_path), hashValue(0), isDone(false), 
+        startT(Clock::now()),
         thread1(&ThreadJob::doWork, this) // starts thread
     {
     }
@@ -77,6 +86,7 @@ void ThreadJob::doWork() {
         hashValue = Hasher::compute(path);  // hashValue = Md5::compute(joinBuf);
     } catch (...) {
     }
+    doneT = Clock::now();
     threadCnt--;
     isDone = true;
 }
@@ -93,6 +103,7 @@ static ThreadGroups threadGroups;
 // static ThreadGroups doneGroups;
 
 // Forward declaration
+static void addTailTime(const ThreadJob* jobPtr);
 void anyFinishedGroups(Command& command);
 void finishGroup(Command& command, ThreadGroup& group);
 
@@ -119,14 +130,36 @@ void Hasher::findDupsAsync(Command& command, const StringList& baseDirList, cons
     threadGroups.push_back(group);
 }
 
-void Hasher::waitForAsync(Command& command) {
-    while (threadCnt > 0) {
+// Walk is done, same reference for first-come and -largeFirst dispatch.
+void Hasher::beginTail() {
+    tailStartT = Clock::now();
+    tailBusySec = 0;
+}
+
+// Stats returned, caller prints them once reporter thread released stdout.
+Hasher::TailStats Hasher::waitForAsync(Command& command) {
+    while (threadCnt > 0 || !threadGroups.empty()) {
         // std::cerr << "waiting for all threads to finish, cnt=" << threadCnt << std::endl;
         anyFinishedGroups(command);
         if (threadCnt != 0) 
             (void)lock1.try_lock_shared_for(std::chrono::seconds(1));
     }
     // std::cerr << "Done using " << MAX_THREADS << " threads\n";
+
+    TailStats stats;
+    if (tailEndT > tailStartT) {
+        stats.tailSec = std::chrono::duration<double>(tailEndT - tailStartT).count();
+        stats.idleSec = stats.tailSec * MAX_THREADS - tailBusySec;
+    }
+    return stats;
+}
+
+// Accumulate time job was busy after the walk ended.
+static void addTailTime(const ThreadJob* jobPtr) {
+    Clock::time_point begT = std::max(jobPtr->startT, tailStartT);
+    if (jobPtr->doneT > begT)
+        tailBusySec += std::chrono::duration<double>(jobPtr->doneT - begT).count();
+    tailEndT = std::max(tailEndT, jobPtr->doneT);
 }
 
 void anyFinishedGroups(Command& command) {
@@ -158,11 +191,13 @@ void anyFinishedGroups(Command& command) {
 void finishGroup(Command& command, ThreadGroup& group) {
    ThreadGroup::iterator jobIter = group.begin(); 
    ThreadJob* firstPtr = *jobIter++;
+   addTailTime(firstPtr);
    if (command.verbose)
        cerr << firstPtr->path << " hash=" << firstPtr->hashValue << std::endl;
 
    while (jobIter != group.end()) {
        ThreadJob* secondPtr  = *jobIter++;
+       addTailTime(secondPtr);
        if (command.verbose)
            cerr << secondPtr->path << " hash=" << secondPtr->hashValue << std::endl;
 
@@ -171,10 +206,21 @@ void finishGroup(Command& command, ThreadGroup& group) {
        } else {
            command.showDifferent(firstPtr->path, secondPtr->path);
        }
+   }
 
-       delete secondPtr;
+   if (group.size() > 2) {
+       // Every root holds a copy of same size, vote on hash.
+       StringList paths;
+       std::vector<uint64_t> hashes;
+       for (const ThreadJob* jobPtr : group) {
+           paths.push_back(jobPtr->path);
+           hashes.push_back(jobPtr->hashValue);
+       }
+       command.showVote(paths, std::vector<bool>(group.size(), true), std::vector<uint64_t>(group.size(), 0), hashes);
    }
-   delete firstPtr;
+
+   for (ThreadJob* jobPtr : group)
+       delete jobPtr;
    group.clear();
 }
 
@@ -6,6 +6,8 @@
 //  Copyright © 2026 Dennis Lang. All rights reserved.
 //
 
+#pragma once
+
 #include "ll_stdhdr.hpp"
 #include "command.hpp"
 #include <vector>
@@ -25,9 +27,19 @@ typedef uint64_t HashValue;         // xxHash64
 
 class Hasher  {
 public:
+    // Most roots findDupsAsync takes, one thread and read buffer per root.
+    static constexpr size_t MAX_ASYNC_ROOTS = 8;
+
+    // Time from beginTail (end of walk) until all hash threads finished.
+    struct TailStats {
+        double tailSec = 0;         // 0 if no job ran after beginTail
+        double idleSec = 0;         // thread seconds idle during tail
+    };
+    static void beginTail();
+
     // Compute hash values of a set of files using threads. 
     static void findDupsAsync(Command& _command, const StringList& baseDirList, const string& file);
-    static void waitForAsync(Command& command);
+    static TailStats waitForAsync(Command& command);
 
     // Compute hash value of a single file in caller's thread. 
     static HashValue compute(const string & path);
@@ -49,6 +49,7 @@
 #include "directory.hpp"
 #include "command.hpp"
 #include "dupscan.hpp"
+#include "reporter.hpp"
 
 
 #include <fstream>
@@ -56,6 +57,8 @@
 #include <vector>
 #include <regex>
 #include <exception>
+#include <deque>
+#include <memory>
 
 using namespace std;
 
@@ -63,35 +66,109 @@ using namespace std;
 typedef unsigned int uint;
 
 // ---------------------------------------------------------------------------
-// Dive into directories, locate files.
-static size_t InspectFiles(Command& command, const lstring& dirname) {
-    Directory_files directory(dirname);
-    lstring fullname;
+// Directory waiting to be scanned. With -dirfd the parent handle is held
+// so the child opens relative to it (openat), otherwise opened by path.
+// Only directory opens change, files are still recorded and hashed by full path.
+struct PendingDir {
+    lstring path;
+    lstring name;
+    std::shared_ptr<Directory_files> parent;
+};
+typedef std::deque<PendingDir> PendingDirs;
+
+static const unsigned MAX_OPEN_DIRS = 64;   // cap on simultaneously open directory handles
+static unsigned openDirCnt = 0;
+static const double MAX_DAYS = 1e6;         // -newer/-older limit, keeps seconds in time_t range
+
+static std::shared_ptr<Directory_files> openDir(const PendingDir& pending) {
+    Directory_files* pDir = pending.parent
+        ? new Directory_files(*pending.parent, pending.name)
+        : new Directory_files(pending.path);
+    openDirCnt++;
+    return std::shared_ptr<Directory_files>(pDir, [](Directory_files* pDir) {
+        openDirCnt--;
+        delete pDir;
+    });
+}
 
+// ---------------------------------------------------------------------------
+// Dive into directories, locate files. Iterative, each directory is read
+// completely and closed (or held as parent) before its children are visited.
+// Children keep listing order so siblings stay together, DFS by default or BFS (-bfs).
+static size_t InspectFiles(Command& command, const lstring& dirname) {
+    lstring name, fullname;
+    FileInfo info;
+    unsigned infoNeed = command.infoNeed();
+    bool needFullName = command.hasPathPatterns() || command.verbose;
     size_t fileCount = 0;
 
-    struct stat filestat;
-    try {
-        if (stat(dirname, &filestat) == 0 && S_ISREG(filestat.st_mode)) {
-            fileCount += command.add(dirname);
-            return fileCount;
+    PendingDirs pendingDirs;
+    std::vector<PendingDir> subDirs;
+    pendingDirs.push_back(PendingDir{dirname, "", nullptr});
+
+    while (!Signals::aborted && !pendingDirs.empty()) {
+        std::shared_ptr<Directory_files> directory;
+        if (command.useBfs) {
+            directory = openDir(pendingDirs.front());
+            pendingDirs.pop_front();
+        } else {
+            directory = openDir(pendingDirs.back());
+            pendingDirs.pop_back();
         }
-    } catch (const exception& ignore) {
-        // Probably a pattern, let directory scan do its magic.
-    }
+#ifndef HAVE_WIN
+        directory->setSortInode(command.sortInode);
+#endif
 
-    while (!Signals::aborted &&  directory.more()) {
-        directory.fullName(fullname);
-        if (directory.is_directory()) {
-            fileCount += InspectFiles(command, fullname);
-        } else if (fullname.length() > 0) {
-            fileCount += command.add(fullname);
+        subDirs.clear();
+        // Full name built for path patterns or verbose, else only for kept entries.
+        while (!Signals::aborted && directory->more()) {
+            command.readCnt++;
+            name = directory->name();
+            if (needFullName)
+                directory->fullName(fullname);
+            if (directory->is_directory()) {
+                if (command.validDir(name, fullname)) {
+                    if (! needFullName)
+                        directory->fullName(fullname);
+                    subDirs.push_back(PendingDir{fullname, name, nullptr});
+                }
+            } else if (command.validFile(name, fullname)) {
+                if (! needFullName)
+                    directory->fullName(fullname);
+                if (infoNeed == INFO_NONE || !directory->getInfo(info, infoNeed))
+                    info = FileInfo();
+                fileCount += command.addValid(fullname, fullname.length() - name.length(), info);
+            }
+        }
+
+        // Hold handle for children while under cap, else release it now.
+        if (command.useDirFd && !subDirs.empty() && openDirCnt <= MAX_OPEN_DIRS) {
+            for (PendingDir& subDir : subDirs)
+                subDir.parent = directory;
+        }
+        directory.reset();
+
+        if (command.useBfs) {
+            pendingDirs.insert(pendingDirs.end(), subDirs.begin(), subDirs.end());
+        } else {
+            pendingDirs.insert(pendingDirs.end(), subDirs.rbegin(), subDirs.rend());
         }
     }
 
     return fileCount;
 }
 
+// ---------------------------------------------------------------------------
+// Scan file or directory tree, root is the only path checked with stat.
+static size_t InspectRoot(Command& command, const lstring& dirname) {
+    FileInfo info;
+    if (DirUtil::getInfo(info, dirname) && S_ISREG(info.mode))
+        return command.add(dirname, info);
+
+    // Directory or pattern, let directory scan do its magic.
+    return InspectFiles(command, dirname);
+}
+
 // ---------------------------------------------------------------------------
 void showHelp(const char* arg0) {
     const char* helpMsg = "  Dennis Lang " VERSION " (landenlabs.com) " __DATE__ "\n\n"
@@ -105,6 +182,7 @@ void showHelp(const char* arg0) {
         "   -_y_includeItem=<filePattern>   ; -inc=*.java \n"
         "   -_y_excludeItem=<filePattern>   ; -exc=*.bat -exc=dir1 \n"
         "   _p_Note: Capitalized _Y_I_X_nclude/_Y_E_X_xclude for full path pattern \n"
+        "   _p_Note: Excluded directories are pruned, their subtree is not scanned \n"
 #ifdef HAVE_WIN
         "   _p_Note: Escape directory slash on windows \n"
         "   -_y_IncludePath=<pathPattern>   ; -Inc=*\\\\code\\\\*.java \n"
@@ -138,14 +216,25 @@ void showHelp(const char* arg0) {
         "   -_y_postDivider=<text> ; Divider for dup and diff, def: \"__\\n\"  \n"
         "   -_y_separator=<text>   ; Separator, def: \", \"  \n"
         "   -_y_ignoreCase         ; Used with include/exclude patterns  \n"
+        "   -_y_minSize=<size>     ; Skip files smaller, ex: 1m (k, m or g suffix)  \n"
+        "   -_y_maxSize=<size>     ; Skip files larger  \n"
+        "   -_y_newer=<days>       ; Skip files modified more than days ago  \n"
+        "   -_y_older=<days>       ; Skip files modified within days  \n"
         "\n"
-        "_p_Options (when scanning two directories, dup if names and hash match) :\n"
+        "_p_Options (when scanning two or more directories, dup if names and hash match) :\n"
+        "   _p_Note: More than two directories compares each with the first, \n"
+        "   _p_      -showDiff or -showMiss adds \"?? votes/roots file\" when roots disagree \n"
         "   -_y_simple                      ; Show files no prefix or separators \n"
         "   -_y_log=[first|second]          ; Only show 1st or 2nd file for Dup or Diff \n"
         "   -_y_no                          ; DryRun, show delete but don't do delete \n"
         "   -_y_delete=[first|second|both]  ; If dup or diff, delete 1st, 2nd or both files \n"
         "   -_y_link                        ; Hard link duplicates \n"
         "   -_y_threads                     ; Compute file hashes in threads \n"
+        "   -_y_largeFirst                  ; Threads hash largest first, in windows of 256 files \n"
+        "   -_y_dfs                         ; Compare depth first, memory bounded by depth \n"
+        "   -_y_quick                       ; Same size and modify time is dup, no read \n"
+        "   -_y_sample=<percent>            ; With -quick, content verify percent of files, same files each run \n"
+        "   -_y_skew=<seconds>              ; With -quick, verify if times differ by up to seconds \n"
         "\n"
         "_p_Options when using -_y_all\n"
         "        Default compares all files for matching length and hash value\n"
@@ -153,8 +242,15 @@ void showHelp(const char* arg0) {
         "   -_y_ignoreExtn                  ; With -justName, also ignore extension \n"
         "   -_y_delDupPat=pathPat           ; If dup   delete if pattern match, use -showabs \n"
         "   -_y_justName                    ; Match name only, not contents \n"
+        "   -_y_ignoreHardlinks             ; Report one path per inode, hard links are not dups \n"
+#ifndef HAVE_WIN
+        "   -_y_dirfd                       ; With -all open sub directories via parent handle (openat), files still by path \n"
+#endif
+        "   -_y_bfs                         ; Scan directories breadth first, default depth first \n"
+        "   -_y_sortInode                   ; Stat and hash in inode order (cold cache) \n"
+        "   -_y_radixGroup                  ; Group by parallel radix sort, output in size order \n"
+        "   -_y_maxMem=<size>               ; With -all spill file list to temp files above size (min 1m), ex: 500m \n"
 
-        //        "   -ignoreHardlinks   ; \n"
         //        "   -ignoreSoftlinks    ; \n"
         "\n"
         "_p_Examples: \n"
@@ -260,6 +356,36 @@ int main(int argc, char* argv[]) {
                             }
                         }
                         break;
+                    case 'm':   // -minSize=<size>  -maxSize=<size>  -maxMem=<size>
+                        if (parser.validOption("minSize", cmdName, false)) {
+                            if (!Command::getSize(commandPtr->minSize, value))
+                                parser.showUnknown(argStr);
+                        } else if (parser.validOption("maxSize", cmdName, false)) {
+                            if (!Command::getSize(commandPtr->maxSize, value))
+                                parser.showUnknown(argStr);
+                        } else if (parser.validOption("maxMem", cmdName)) {
+                            if (!Command::getSize(commandPtr->maxMem, value))
+                                parser.showUnknown(argStr);
+                        }
+                        break;
+                    case 'n':   // -newer=<days>
+                        if (parser.validOption("newer", cmdName)) {
+                            double days;
+                            if (Command::getNumber(days, value, MAX_DAYS))
+                                commandPtr->newerTime = time(0) - (time_t)(days * 24 * 60 * 60);
+                            else
+                                parser.showUnknown(argStr);
+                        }
+                        break;
+                    case 'o':   // -older=<days>
+                        if (parser.validOption("older", cmdName)) {
+                            double days;
+                            if (Command::getNumber(days, value, MAX_DAYS))
+                                commandPtr->olderTime = time(0) - (time_t)(days * 24 * 60 * 60);
+                            else
+                                parser.showUnknown(argStr);
+                        }
+                        break;
                     case 'p':
                         if (parser.validOption("postDivider", cmdName, false)) {
                             commandPtr->postDivider = ParseUtil::convertSpecialChar(value);
@@ -273,9 +399,18 @@ int main(int argc, char* argv[]) {
                             commandPtr->preMissing = ParseUtil::convertSpecialChar(value);
                         }
                         break;
-                    case 's':
-                        if (parser.validOption("separator", cmdName)) {
+                    case 's':   // -separator=<text>  -sample=<percent>  -skew=<seconds>
+                        if (parser.validOption("separator", cmdName, false)) {
                             commandPtr->separator = ParseUtil::convertSpecialChar(value);
+                        } else if (parser.validOption("sample", cmdName, false)) {
+                            if (!Command::getNumber(commandPtr->quickSample, value, 100))
+                                parser.showUnknown(argStr);
+                        } else if (parser.validOption("skew", cmdName)) {
+                            double skew;
+                            if (Command::getNumber(skew, value, 1e9))
+                                commandPtr->quickSkew = (time_t)skew;
+                            else
+                                parser.showUnknown(argStr);
                         }
                         break;
 
@@ -292,6 +427,18 @@ int main(int argc, char* argv[]) {
                             commandPtr->allFiles = true;
                         }
                         break;
+                    case 'b':
+                        if (parser.validOption("bfs", cmdName)) {
+                            commandPtr->useBfs = true;
+                        }
+                        break;
+                    case 'd':
+                        if (parser.validOption("dirfd", cmdName, false)) {
+                            commandPtr->useDirFd = true;
+                        } else if (parser.validOption("dfs", cmdName)) {
+                            commandPtr->useDfs = true;
+                        }
+                        break;
                     case 'f': // duplicated files
                         if (parser.validOption("files", cmdName)) {
                             commandPtr = &dupFiles.share(*commandPtr);
@@ -312,22 +459,32 @@ int main(int argc, char* argv[]) {
                             commandPtr->ignoreExtn = true;
                         } else if (parser.validOption("ignoreCase", cmdName, false) || parser.validOption("ic", cmdName, false)) {
                             parser.ignoreCase = true;
+                        } else if (parser.validOption("ignoreHardlinks", cmdName, false)) {
+                            commandPtr->ignoreHardLinks = true;
                         } else {
-                            parser.reportError(cmdName, "invert or ignoreExtn or ignoreCase");
+                            parser.reportError(cmdName, "invert or ignoreExtn or ignoreCase or ignoreHardlinks");
                         }
                         break;
                     case 'j':
                         commandPtr->justName = parser.validOption("justName", cmdName);
                         break;
                     case 'l':
-                        commandPtr->hardlink = parser.validOption("link", cmdName);
+                        if (parser.validOption("link", cmdName, false)) {
+                            commandPtr->hardlink = true;
+                        } else if (parser.validOption("largeFirst", cmdName)) {
+                            commandPtr->useThreads = commandPtr->largeFirst = true;
+                        }
                         break;
                     case 'n':   // no action, dry-run
                         std::cerr << "DryRun enabled\n";
                         commandPtr->dryRun = true;
                         break;
                     case 'r':   // -regex
-                        parser.unixRegEx = parser.validOption("regex", cmdName);
+                        if (parser.validOption("regex", cmdName, false)) {
+                            parser.unixRegEx = true;
+                        } else if (parser.validOption("radixGroup", cmdName)) {
+                            commandPtr->radixGroup = true;
+                        }
                         break;
                     case 's':
                         if (parser.validOption("showAll", cmdName, false)) {
@@ -346,6 +503,8 @@ int main(int argc, char* argv[]) {
                             commandPtr->preDup = commandPtr->preDiff = "";
                             commandPtr->separator = " ";
                             commandPtr->postDivider = "\n";
+                        } else if (parser.validOption("sortInode", cmdName, false)) {
+                            commandPtr->sortInode = true;
                         } else if (parser.validOption("showProgress", cmdName)) {
                             commandPtr->showProgress = true;
                         }
@@ -356,9 +515,11 @@ int main(int argc, char* argv[]) {
                         }
                         break;
                     case 'q':
-                        if (parser.validOption("quiet", cmdName)) {
+                        if (parser.validOption("quiet", cmdName, false)) {
                             commandPtr->quiet++;
                             commandPtr->showSame = commandPtr->showFile = commandPtr->showDiff = commandPtr->showMiss = false;
+                        } else if (parser.validOption("quick", cmdName)) {
+                            commandPtr->quick = true;
                         }
                         break;
                     case 'v':
@@ -406,35 +567,49 @@ int main(int argc, char* argv[]) {
                 if (extraDirList.size() == 1 && extraDirList[0] == "-") {
                     string filePath;
                     while (std::getline(std::cin, filePath)) {
-                         size_t fileCnt = InspectFiles(*commandPtr, filePath);
+                         size_t fileCnt = InspectRoot(*commandPtr, filePath);
                          if (commandPtr->quiet < 1)
-                            std::cerr << "  Files Checked=" << fileCnt << std::endl;
+                            std::cerr << "  Files Checked=" << fileCnt << (commandPtr->useDirFd ? " (dirfd)" : "") << std::endl;
                     }
                 } else if (commandPtr->ignoreExtn || !commandPtr->sameName || commandPtr->allFiles) {
                     for (auto const& filePath : extraDirList) {
-                        size_t fileCnt = InspectFiles(*commandPtr, filePath);
+                        size_t fileCnt = InspectRoot(*commandPtr, filePath);
                         if (commandPtr->quiet < 1)
-                            std::cerr << "  Files Checked=" << fileCnt << std::endl;
+                            std::cerr << "  Files Checked=" << fileCnt << (commandPtr->useDirFd ? " (dirfd)" : "") << std::endl;
                     }
-                } else if (extraDirList.size() == 2) {
+                } else if (extraDirList.size() >= 2) {
+                    if (commandPtr->useDirFd)
+                        Colors::showError("-dirfd only applies to -all walking, directory compare always opens via parent handle");
                     DupScan dupScan(*commandPtr);
-                    StringSet nextDirList;
-                    nextDirList.insert("");
+                    StringSet nextDirList(1, "");
+                    if (commandPtr->useThreads)
+                        Reporter::start();      // stdout and link/delete owned by reporter thread
                   
-                    while (!Signals::aborted && dupScan.findDuplicates(level, extraDirList, nextDirList)) {
-                        level++;
-                        if (commandPtr->showProgress) {
-                            std::cerr << Colors::colorize("_G_ +Levels=") << level
-                                << " Dup=" << commandPtr->sameCnt
-                                << " Diff=" << commandPtr->diffCnt
-                                << " Miss=" << commandPtr->missCnt
-                                << " Skip=" << commandPtr->skipCnt
-                                << " Files=" << commandPtr->sameCnt + commandPtr->diffCnt + commandPtr->missCnt + commandPtr->skipCnt
-                                << Colors::colorize("_X_\n");
+                    if (commandPtr->useDfs) {
+                        level = dupScan.scanTree(extraDirList);
+                    } else {
+                        while (!Signals::aborted && dupScan.findDuplicates(level, extraDirList, nextDirList)) {
+                            level++;
+                            if (commandPtr->showProgress) {
+                                std::cerr << Colors::colorize("_G_ +Levels=") << level
+                                    << " Dup=" << commandPtr->sameCnt
+                                    << " Diff=" << commandPtr->diffCnt
+                                    << " Miss=" << commandPtr->missCnt
+                                    << " Skip=" << commandPtr->skipCnt
+                                    << " Pruned=" << commandPtr->pruneCnt
+                                    << " Files=" << commandPtr->sameCnt + commandPtr->diffCnt + commandPtr->missCnt + commandPtr->skipCnt
+                                    << Colors::colorize("_X_\n");
+                            }
                         }
                     }
 
-                    dupScan.done();
+                    Hasher::TailStats tailStats = dupScan.done();
+                    Reporter::stop();
+                    if (commandPtr->quiet < 2 && tailStats.tailSec != 0) {
+                        // After reporter stopped, stderr no longer interleaves with its stdout.
+                        std::cerr << " +Hash tail=" << tailStats.tailSec << " (sec) idle=" << tailStats.idleSec << " (thread sec)"
+                            << (commandPtr->largeFirst ? " largeFirst" : "") << std::endl;
+                    }
                 }
             }
 
@@ -447,9 +622,38 @@ int main(int argc, char* argv[]) {
                 << " Diff=" << commandPtr->diffCnt
                 << " Miss=" << commandPtr->missCnt
                 << " Skip=" << commandPtr->skipCnt
+                << " Pruned=" << commandPtr->pruneCnt
+                << " Linked=" << commandPtr->linkCnt
+                << " Filtered=" << commandPtr->filterCnt
                 << " Files=" << commandPtr->sameCnt + commandPtr->diffCnt + commandPtr->missCnt + commandPtr->skipCnt
                 << Colors::colorize("_X_\n");
 
+        if (commandPtr->quiet < 2 && commandPtr->agreeCnt + commandPtr->majorityCnt + commandPtr->splitCnt != 0) {
+            std::cerr << Colors::colorize("_G_ +Roots=") << extraDirList.size()
+                << " Agree=" << commandPtr->agreeCnt
+                << " Majority=" << commandPtr->majorityCnt
+                << " Split=" << commandPtr->splitCnt
+                << Colors::colorize("_X_\n");
+        }
+
+        if (commandPtr->quiet < 2 && commandPtr->pruneCnt != 0) {
+            std::cerr << Colors::colorize("_G_ +Entries read=") << commandPtr->readCnt
+                << " (" << commandPtr->pruneCnt << " pruned subtrees not enumerated)"
+                << Colors::colorize("_X_\n");
+        }
+
+        if (commandPtr->quiet < 2 && commandPtr->sharedCnt != 0) {
+            std::cerr << Colors::colorize("_G_ +Shared=") << commandPtr->sharedCnt
+                << " (same inode or extents, not read)"
+                << Colors::colorize("_X_\n");
+        }
+
+        if (commandPtr->quiet < 2 && commandPtr->quick) {
+            std::cerr << Colors::colorize("_G_ +Quick=") << commandPtr->quickCnt
+                << " Verified=" << commandPtr->verifyCnt
+                << Colors::colorize("_X_\n");
+        }
+
         if (commandPtr->quiet < 2 && commandPtr->hardlink) {
             DirUtil::LinkCnts linkCnts = DirUtil::getLinkCnts();
             std::cerr << Colors::colorize(linkCnts.failed != 0 ? "_R_" : (linkCnts.completed != 0 ? "_G_" : "_Y_"))
@@ -34,6 +34,7 @@
 
 
 #include <string>
+#include <string_view>
 #include <algorithm>
 #include <regex>        // ReplaceAll using regex
 
@@ -53,12 +54,15 @@ public:
 
     lstring(const lstring& rhs) : std::string(rhs)
     { }
-    lstring(const lstring&& rhs) noexcept  : std::string(rhs)
+    lstring(lstring&& rhs) noexcept : std::string(std::move(rhs))
     { }
 
     lstring(const std::string& rhs) : std::string(rhs)
     { }
-    lstring(const std::string&& rhs) : std::string(rhs)
+    lstring(std::string&& rhs) noexcept : std::string(std::move(rhs))
+    { }
+
+    explicit lstring(std::string_view rhs) : std::string(rhs)
     { }
 
     std::string& toString()
@@ -97,6 +101,27 @@ public:
         this->assign(rhs);
         return *this;
     }
+    lstring& operator=(lstring&& rhs) noexcept {
+        std::string::operator=(std::move(rhs));
+        return *this;
+    }
+    // Assign in place, reuses capacity instead of building a temporary lstring.
+    lstring& operator=(const std::string& rhs) {
+        this->assign(rhs);
+        return *this;
+    }
+    lstring& operator=(std::string&& rhs) noexcept {
+        std::string::operator=(std::move(rhs));
+        return *this;
+    }
+    lstring& operator=(const char* rhs) {
+        this->assign(rhs);      // rhs may point into this string
+        return *this;
+    }
+    lstring& operator=(std::string_view rhs) {
+        this->assign(rhs.data(), rhs.length());
+        return *this;
+    }
 
     lstring& toLower() {
         transform(begin(), end(), begin(),::tolower);
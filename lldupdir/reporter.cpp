@@ -0,0 +1,164 @@
+//-------------------------------------------------------------------------------------------------
+//
+// File: reporter.cpp   Author: Dennis Lang  Desc: Reporter thread, owns stdout and file actions
+//
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2024
+// https://landenlabs.com
+//
+//  
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "reporter.hpp"
+#include "command.hpp"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <iostream>
+
+std::atomic<bool> Reporter::running(false);
+
+static ReportQueue reportQueue;
+static std::thread reportThread;
+static std::atomic<size_t> postedCnt(0);
+static std::atomic<size_t> reportedCnt(0);
+
+// Reporter thread sleeps on wakeCond while queue is empty, post and stop wake it.
+static std::mutex wakeMutex;
+static std::condition_variable wakeCond;
+static std::atomic<bool> sleeping(false);
+
+// ---------------------------------------------------------------------------
+static void wake() {
+    std::lock_guard<std::mutex> lock(wakeMutex);
+    wakeCond.notify_one();
+}
+
+// ---------------------------------------------------------------------------
+ReportQueue::ReportQueue() : head(&stub), tail(&stub) {
+}
+
+// ---------------------------------------------------------------------------
+void ReportQueue::push(Report* report) {
+    report->next.store(nullptr, std::memory_order_relaxed);
+    Report* prev = head.exchange(report, std::memory_order_acq_rel);
+    prev->next.store(report, std::memory_order_release);
+}
+
+// ---------------------------------------------------------------------------
+Report* ReportQueue::pop() {
+    Report* last = tail;
+    Report* next = last->next.load(std::memory_order_acquire);
+    if (last == &stub) {
+        if (next == nullptr)
+            return nullptr;
+        tail = next;
+        last = next;
+        next = next->next.load(std::memory_order_acquire);
+    }
+    if (next != nullptr) {
+        tail = next;
+        return last;
+    }
+    if (last != head.load(std::memory_order_acquire))
+        return nullptr;     // producer between exchange and link, try again later
+
+    push(&stub);
+    next = last->next.load(std::memory_order_acquire);
+    if (next != nullptr) {
+        tail = next;
+        return last;
+    }
+    return nullptr;
+}
+
+// ---------------------------------------------------------------------------
+void Reporter::start() {
+    if (! running) {
+        running = true;
+        reportThread = std::thread(&Reporter::run);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Wait for queue to drain, then release stdout back to caller.
+void Reporter::stop() {
+    if (running) {
+        running = false;
+        wake();
+        if (reportThread.joinable())
+            reportThread.join();
+        std::cout.flush();
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Producer counts post then reads sleeping, reporter sets sleeping then reads
+// the count (both seq_cst), so one of them always sees the other.
+void Reporter::post(Report* report) {
+    postedCnt++;
+    reportQueue.push(report);
+    if (sleeping)
+        wake();
+}
+
+// ---------------------------------------------------------------------------
+void Reporter::run() {
+    while (running || reportedCnt != postedCnt) {
+        Report* report = reportQueue.pop();
+        if (report != nullptr) {
+            process(report);
+            delete report;
+            reportedCnt++;
+        } else if (reportedCnt != postedCnt) {
+            std::this_thread::yield();      // producer between push exchange and link
+        } else {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            sleeping = true;
+            if (running && reportedCnt == postedCnt)
+                wakeCond.wait(lock);
+            sleeping = false;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+void Reporter::process(Report* report) {
+    Command& command = *report->command;
+    switch (report->kind) {
+    case Report::DUP:
+        command.reportDuplicate(report->path1, report->path2, &report->info1, &report->info2);
+        break;
+    case Report::DIFF:
+        command.reportDifferent(report->path1, report->path2);
+        break;
+    case Report::MISS:
+        command.reportMissing(report->have1, report->path1, report->have2, report->path2);
+        break;
+    case Report::VOTE:
+        command.reportVote(report->path1, report->votes, report->roots);
+        break;
+    }
+}
@@ -0,0 +1,113 @@
+//-------------------------------------------------------------------------------------------------
+// File: reporter.hpp
+// Author: Dennis Lang
+//
+// Desc: Single reporter thread which owns stdout and performs the link and delete
+//       actions for duplicate, different and missing results.
+//
+// Usage::
+//      Results are posted to a lock-free multi-producer single-consumer queue so
+//      threads computing hash values never block on output or file system changes.
+//
+//          Reporter::start();
+//          Reporter::post(new Report(Report::DUP, command, path1, path2));
+//          ...
+//          Reporter::stop();   // drain queue and join reporter thread
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2024
+// https://landenlabs.com
+//
+//  
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#include "ll_stdhdr.hpp"
+#include "directory.hpp"    // FileInfo
+
+#include <atomic>
+
+class Command;
+
+// ---------------------------------------------------------------------------
+// Queued result, linked into the MPSC queue by 'next'.
+class Report {
+public:
+    enum Kind { DUP, DIFF, MISS, VOTE };
+
+    Kind kind;
+    Command* command;
+    lstring path1;
+    lstring path2;
+    bool have1;
+    bool have2;
+    FileInfo info1;         // optional metadata, avoids stat when linking
+    FileInfo info2;
+    unsigned votes = 0;     // VOTE, identical copies out of roots
+    unsigned roots = 0;
+    std::atomic<Report*> next;
+
+    Report() : kind(DUP), command(nullptr), have1(true), have2(true), next(nullptr) {}
+    Report(Kind _kind, Command& _command, const lstring& _path1, const lstring& _path2,
+            bool _have1 = true, bool _have2 = true) :
+        kind(_kind), command(&_command), path1(_path1), path2(_path2),
+        have1(_have1), have2(_have2), next(nullptr) {}
+};
+
+// ---------------------------------------------------------------------------
+// Intrusive lock-free multi-producer single-consumer queue (Vyukov).
+//   push - any thread, wait-free single atomic exchange.
+//   pop  - reporter thread only, returns nullptr if empty.
+class ReportQueue {
+public:
+    ReportQueue();
+    void push(Report* report);
+    Report* pop();
+
+private:
+    std::atomic<Report*> head;      // producers append here
+    Report* tail;                   // consumer removes here
+    Report stub;
+};
+
+// ---------------------------------------------------------------------------
+class Reporter {
+public:
+    static void start();
+    static void stop();
+
+    // True while reporter thread owns stdout.
+    static bool isRunning() {
+        return running;
+    }
+
+    // Queue report, ownership passes to reporter thread.
+    static void post(Report* report);
+
+private:
+    static void run();
+    static void process(Report* report);
+
+    static std::atomic<bool> running;
+};
@@ -0,0 +1,162 @@
+//-------------------------------------------------------------------------------------------------
+//
+// File: spillruns.cpp   Author: Dennis Lang  Desc: Sorted runs spilled to temporary files.
+//
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2024
+// https://landenlabs.com
+//
+//
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "ll_stdhdr.hpp"
+#include "spillruns.hpp"
+
+#include <algorithm>
+
+// ---------------------------------------------------------------------------
+void SpillRuns::clear() {
+    for (FILE* run : runs)
+        fclose(run);
+    runs.clear();
+    levels.clear();
+}
+
+// ---------------------------------------------------------------------------
+FILE* SpillRuns::newRun() {
+    FILE* run = tmpfile();
+    if (run != nullptr)
+        setvbuf(run, nullptr, _IOFBF, BUFFER_SIZE);
+    return run;
+}
+
+// ---------------------------------------------------------------------------
+bool SpillRuns::beginRun() {
+    // Fold last FAN_IN runs of equal level into one, repeat up the levels.
+    while (runs.size() >= FAN_IN
+            && levels[runs.size() - FAN_IN] == levels.back()) {
+        size_t first = runs.size() - FAN_IN;
+        unsigned level = levels.back() + 1;
+        FILE* merged = newRun();
+        bool writeOk = (merged != nullptr);
+        if (! writeOk || ! mergeRuns(first, [&](const SpillRecord& record) {
+                writeOk = writeOk && write(merged, record);
+            }) || ! writeOk) {
+            if (merged != nullptr)
+                fclose(merged);
+            return false;
+        }
+        runs.push_back(merged);
+        levels.push_back(level);
+    }
+
+    FILE* run = newRun();
+    if (run == nullptr)
+        return false;
+    runs.push_back(run);
+    levels.push_back(0);
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+void SpillRuns::dropRun() {
+    fclose(runs.back());
+    runs.pop_back();
+    levels.pop_back();
+}
+
+// ---------------------------------------------------------------------------
+bool SpillRuns::write(const SpillRecord& record) {
+    return write(runs.back(), record);
+}
+
+// ---------------------------------------------------------------------------
+// Record layout: size, hash, FileInfo, path length, path (no nul).
+bool SpillRuns::write(FILE* run, const SpillRecord& record) {
+    uint32_t pathLen = (uint32_t)record.path.length();
+    return fwrite(&record.size, sizeof(record.size), 1, run) == 1
+        && fwrite(&record.hash, sizeof(record.hash), 1, run) == 1
+        && fwrite(&record.info, sizeof(record.info), 1, run) == 1
+        && fwrite(&pathLen, sizeof(pathLen), 1, run) == 1
+        && fwrite(record.path.c_str(), 1, pathLen, run) == pathLen;
+}
+
+// ---------------------------------------------------------------------------
+bool SpillRuns::read(FILE* run, SpillRecord& record) {
+    uint32_t pathLen;
+    if (fread(&record.size, sizeof(record.size), 1, run) != 1
+            || fread(&record.hash, sizeof(record.hash), 1, run) != 1
+            || fread(&record.info, sizeof(record.info), 1, run) != 1
+            || fread(&pathLen, sizeof(pathLen), 1, run) != 1)
+        return false;
+    record.path.resize(pathLen);
+    return pathLen == 0 || fread(&record.path[0], 1, pathLen, run) == pathLen;
+}
+
+// ---------------------------------------------------------------------------
+bool SpillRuns::merge(const std::function<void(const SpillRecord&)>& func) {
+    return mergeRuns(0, func);
+}
+
+// ---------------------------------------------------------------------------
+// k-way merge of runs[first..], a heap holds the run index of each run's next
+// record. Merged runs are closed.
+bool SpillRuns::mergeRuns(size_t first, const std::function<void(const SpillRecord&)>& func) {
+    std::vector<SpillRecord> heads(runs.size());
+    std::vector<size_t> heap;
+    for (size_t runIdx = first; runIdx < runs.size(); runIdx++) {
+        if (fflush(runs[runIdx]) != 0 || fseek(runs[runIdx], 0, SEEK_SET) != 0)
+            return false;
+        if (read(runs[runIdx], heads[runIdx]))
+            heap.push_back(runIdx);
+    }
+
+    // Heap is a max heap, order so smallest (size, hash, run) is on top.
+    auto after = [&heads](size_t lhs, size_t rhs) {
+        if (heads[lhs].size != heads[rhs].size)
+            return heads[lhs].size > heads[rhs].size;
+        if (heads[lhs].hash != heads[rhs].hash)
+            return heads[lhs].hash > heads[rhs].hash;
+        return lhs > rhs;
+    };
+    std::make_heap(heap.begin(), heap.end(), after);
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), after);
+        size_t runIdx = heap.back();
+        func(heads[runIdx]);
+        if (read(runs[runIdx], heads[runIdx]))
+            std::push_heap(heap.begin(), heap.end(), after);
+        else
+            heap.pop_back();
+    }
+
+    bool readOk = true;
+    for (size_t runIdx = first; runIdx < runs.size(); runIdx++) {
+        readOk = readOk && !ferror(runs[runIdx]);
+        fclose(runs[runIdx]);
+    }
+    runs.resize(first);
+    levels.resize(first);
+    return readOk;
+}
@@ -0,0 +1,105 @@
+//-------------------------------------------------------------------------------------------------
+// File: spillruns.hpp
+// Author: Dennis Lang
+//
+// Desc: Sorted runs of file records spilled to temporary files and read back
+//       with a k-way merge, keeps -all scans within a memory budget (-maxMem).
+//
+// Usage::
+//          SpillRuns runs;
+//          runs.beginRun();
+//          runs.write(record);     // records in (size, hash) order
+//          ...
+//          runs.merge([](const SpillRecord& record) { ... });
+//
+//      Merge visits records of all runs in (size, hash) order, equal keys in
+//      run order, so runs written in scan order merge in scan order.
+//      Temporary files are removed when closed. Every FAN_IN runs of one level
+//      are merged into a single run of the next level, so open files stay
+//      bounded and each record is rewritten log(runs) times.
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2024
+// https://landenlabs.com
+//
+//
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#include "ll_stdhdr.hpp"
+#include "lstring.hpp"
+#include "directory.hpp"    // FileInfo
+
+#include <vector>
+#include <functional>
+#include <stdio.h>
+#include <stdint.h>
+
+// One file as stored in a run.
+struct SpillRecord {
+    uint64_t size = 0;      // group key
+    uint64_t hash = 0;
+    FileInfo info;
+    lstring path;
+};
+
+// ---------------------------------------------------------------------------
+class SpillRuns {
+public:
+    ~SpillRuns() {
+        clear();
+    }
+
+    // Close and remove all runs.
+    void clear();
+
+    // Start a new run in a temporary file, false if it can not be created.
+    // May first merge earlier runs.
+    bool beginRun();
+
+    // Append record to current run, caller writes records in (size, hash) order.
+    bool write(const SpillRecord& record);
+
+    // Discard current run, after a failed write.
+    void dropRun();
+
+    size_t runCount() const {
+        return runs.size();
+    }
+
+    // Visit records of all runs in (size, hash) order, runs are consumed.
+    bool merge(const std::function<void(const SpillRecord&)>& func);
+
+private:
+    static const size_t BUFFER_SIZE = 1 << 16;     // stdio buffer per run
+    static const size_t FAN_IN = 32;               // runs merged into one
+
+    std::vector<FILE*> runs;
+    std::vector<unsigned> levels;                   // merge level per run
+
+    FILE* newRun();
+    bool mergeRuns(size_t first, const std::function<void(const SpillRecord&)>& func);
+    static bool write(FILE* run, const SpillRecord& record);
+    static bool read(FILE* run, SpillRecord& record);
+};